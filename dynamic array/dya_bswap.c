@@ -0,0 +1,118 @@
+#pragma once
+#include "dya_bswap.h"
+#include "dya_cpu.h"
+#include <string.h> // memcpy
+#if DYA_X86
+#include <immintrin.h>
+#endif
+
+static void (*dya_bswap_resolve(DyaIsa isa))(void*, const void*, size_t,
+    size_t);
+
+DYA_DISPATCH(void, dya_bswap_copy,
+    (void* dst, const void* src, size_t size, size_t width),
+    (dst, src, size, width), dya_bswap_resolve)
+
+void dya_bswap(void* arr, size_t width)
+{
+    assert((width == 2 || width == 4 || width == 8) && "Width is 2, 4 or 8!");
+    assert(dya_size(arr) % width == 0 && "Size is not a multiple of width!");
+    dya_bswap_copy(arr, arr, dya_size(arr), width);
+}
+
+void*(dya_append_bswap)(void* arr, size_t size, const void* src, size_t width)
+{
+    assert((width == 2 || width == 4 || width == 8) && "Width is 2, 4 or 8!");
+    assert(size % width == 0 && "Size is not a multiple of width!");
+    size_t old_size = dya_size(arr);
+    dya_add_size(arr, size);
+    dya_bswap_copy((char*)arr + old_size, src, size, width);
+    return arr;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+// Swaps rows from byte `i` on, one at a time.
+static inline void dya_bswap_tail(char* dst, const char* src, size_t i,
+    size_t size, size_t width)
+{
+    for (; i < size; i += width) {
+        if (width == 2) {
+            uint16_t x;
+            memcpy(&x, src + i, 2);
+            x = __builtin_bswap16(x);
+            memcpy(dst + i, &x, 2);
+        } else if (width == 4) {
+            uint32_t x;
+            memcpy(&x, src + i, 4);
+            x = __builtin_bswap32(x);
+            memcpy(dst + i, &x, 4);
+        } else {
+            uint64_t x;
+            memcpy(&x, src + i, 8);
+            x = __builtin_bswap64(x);
+            memcpy(dst + i, &x, 8);
+        }
+    }
+}
+
+static void dya_bswap_scalar(void* dst, const void* src, size_t size,
+    size_t width)
+{
+    dya_bswap_tail(dst, src, 0, size, width);
+}
+
+#if DYA_X86
+// Byte `k` of every 16-byte lane comes from byte mask[k] of the lane.
+static const char dya_bswap_masks[3][16] = {
+    { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+    { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+    { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 },
+};
+
+// pshufb is SSSE3, which every SSE4.2 CPU has.
+DYA_TARGET_SSE42 static void dya_bswap_sse42(void* out, const void* in,
+    size_t size, size_t width)
+{
+    char* dst = out;
+    const char* src = in;
+    const char* mask = dya_bswap_masks[width == 2 ? 0 : width == 4 ? 1 : 2];
+    __m128i mask128 = _mm_loadu_si128((const __m128i*)mask);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(x, mask128));
+    }
+    dya_bswap_tail(dst, src, i, size, width);
+}
+
+DYA_TARGET_AVX2 static void dya_bswap_avx2(void* out, const void* in,
+    size_t size, size_t width)
+{
+    char* dst = out;
+    const char* src = in;
+    const char* mask = dya_bswap_masks[width == 2 ? 0 : width == 4 ? 1 : 2];
+    __m256i mask256 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)mask));
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i),
+            _mm256_shuffle_epi8(x, mask256));
+    }
+    dya_bswap_tail(dst, src, i, size, width);
+}
+#endif
+
+static void (*dya_bswap_resolve(DyaIsa isa))(void*, const void*, size_t,
+    size_t)
+{
+#if DYA_X86
+    if (isa >= DYA_ISA_AVX2)
+        return dya_bswap_avx2;
+    if (isa >= DYA_ISA_SSE42)
+        return dya_bswap_sse42;
+#endif
+    (void)isa;
+    return dya_bswap_scalar;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Byte swapping of 16-, 32- and 64-bit dyarrays, for data in a foreign byte
+ * order.
+ *
+ * dya_bswap16/32/64 reverse the bytes of every row in place.
+ * dya_append_bswap16/32/64 work like dya_append but swap while they copy, so
+ * data read from a file is converted in the same pass that stores it.
+ * dya_append_be and dya_append_le take the row width from the dyarray and
+ * only swap when the host byte order differs from the source's.
+ *
+ * dya_bswap_copy does the same for plain buffers.
+ *
+ * 32 bytes are swapped at a time with AVX2 byte shuffles, 16 with SSSE3, or
+ * one row at a time, whichever the CPU supports (see dya_cpu.h).
+ *
+ * Usage example:
+    uint32_t* samples = 0;
+    char chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 4, sizeof chunk / 4, file)))
+        dya_append_be(samples, got * 4, chunk);
+ */
+
+// `width` is 2, 4 or 8 and divides dya_size(arr).
+void dya_bswap(void* arr, size_t width);
+// Appends `size` bytes of `src`, with every `width`-byte row reversed.
+void* dya_append_bswap(void* arr, size_t size, const void* src, size_t width);
+// Copies `size` bytes from `src` to `dst` with every `width`-byte row
+// reversed. `dst` and `src` are either the same or do not overlap.
+void dya_bswap_copy(void* dst, const void* src, size_t size, size_t width);
+
+#define dya_bswap16(arr) dya_bswap(arr, 2)
+#define dya_bswap32(arr) dya_bswap(arr, 4)
+#define dya_bswap64(arr) dya_bswap(arr, 8)
+#define dya_append_bswap(arr, size, src, width)                                \
+    (arr = (dya_append_bswap)(arr, size, src, width))
+#define dya_append_bswap16(arr, size, src) dya_append_bswap(arr, size, src, 2)
+#define dya_append_bswap32(arr, size, src) dya_append_bswap(arr, size, src, 4)
+#define dya_append_bswap64(arr, size, src) dya_append_bswap(arr, size, src, 8)
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define dya_append_be(arr, size, src)                                          \
+    dya_append_bswap(arr, size, src, sizeof *(arr))
+#define dya_append_le(arr, size, src) dya_append(arr, size, src)
+#else
+#define dya_append_be(arr, size, src) dya_append(arr, size, src)
+#define dya_append_le(arr, size, src)                                          \
+    dya_append_bswap(arr, size, src, sizeof *(arr))
+#endif
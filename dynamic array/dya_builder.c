@@ -0,0 +1,105 @@
+#pragma once
+#include "dya_builder.h"
+#include <errno.h>
+#include <limits.h> // IOV_MAX
+#include <string.h> // memcpy
+#include <sys/uio.h> // writev
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+static void dya_builder_add(DyaBuilder* b, const char* data, size_t size);
+
+void dya_builder_ref(DyaBuilder* b, size_t size, const void* data)
+{
+    dya_builder_add(b, data, size);
+}
+
+void dya_builder_copy(DyaBuilder* b, size_t size, const void* data)
+{
+    if (!size)
+        return;
+    size_t n_chunks = dya_len(b->chunks);
+    char* last = n_chunks ? b->chunks[n_chunks - 1] : 0;
+    // Chunks are allocated at full capacity up front, so appending to one
+    // never moves the bytes that pieces already point to.
+    if (!last || dya_size(last) + size > DYA_BUILDER_CHUNK) {
+        last = 0;
+        dya_reserve(last, size > DYA_BUILDER_CHUNK ? size : DYA_BUILDER_CHUNK);
+        dya_push(b->chunks, last);
+    }
+    char* to = last + dya_size(last);
+    dya_append(last, size, data);
+    dya_builder_add(b, to, size);
+}
+
+void*(dya_builder_build)(void* out, const DyaBuilder* b)
+{
+    size_t old_size = dya_size(out);
+    dya_set_size(out, old_size + b->size);
+    char* to = (char*)out + old_size;
+    dya_foreach(const DyaStr, piece, b->pieces)
+    {
+        memcpy(to, piece->ptr, piece->len);
+        to += piece->len;
+    }
+    return out;
+}
+
+int dya_builder_write(const DyaBuilder* b, int fd)
+{
+    struct iovec iov[IOV_MAX < 1024 ? IOV_MAX : 1024];
+    size_t n_pieces = dya_len(b->pieces);
+    // The next byte to write is byte `offset` of piece `piece`.
+    size_t piece = 0, offset = 0;
+    while (piece < n_pieces) {
+        size_t n = 0;
+        for (; n < sizeof iov / sizeof *iov && piece + n < n_pieces; n++) {
+            iov[n].iov_base = (char*)b->pieces[piece + n].ptr;
+            iov[n].iov_len = b->pieces[piece + n].len;
+        }
+        iov[0].iov_base = (char*)iov[0].iov_base + offset;
+        iov[0].iov_len -= offset;
+        ssize_t wrote = writev(fd, iov, (int)n);
+        if (wrote < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        for (size_t left = (size_t)wrote; left;) {
+            size_t rest = b->pieces[piece].len - offset;
+            if (left < rest) {
+                offset += left;
+                break;
+            }
+            left -= rest;
+            piece++;
+            offset = 0;
+        }
+    }
+    return 0;
+}
+
+void dya_builder_free(DyaBuilder* b)
+{
+    for (size_t i = 0; i < dya_len(b->chunks); i++)
+        dya_free(b->chunks[i]);
+    dya_free(b->chunks);
+    dya_free(b->pieces);
+    b->size = 0;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static void dya_builder_add(DyaBuilder* b, const char* data, size_t size)
+{
+    if (!size)
+        return;
+    b->size += size;
+    size_t n = dya_len(b->pieces);
+    if (n && b->pieces[n - 1].ptr + b->pieces[n - 1].len == data) {
+        b->pieces[n - 1].len += size;
+        return;
+    }
+    dya_push(b->pieces, ((DyaStr) { data, size }));
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "dya_strsort.h" // DyaStr
+#include "dyarray.h"
+/*
+ * Deferred building of large outputs from many pieces.
+ *
+ * Appending piece after piece to a dyarray regrows and recopies it about
+ * log1.5(size) times. A DyaBuilder only records the pieces: dya_builder_ref
+ * keeps a view of bytes that stay valid until the build, and
+ * dya_builder_copy copies short-lived bytes into chunk buffers of
+ * `DYA_BUILDER_CHUNK` bytes that never move. Consecutive pieces that are
+ * contiguous in memory are merged into one.
+ *
+ * dya_builder_build then reserves the exact total once and copies every
+ * piece once. dya_builder_write skips the dyarray and hands the pieces
+ * straight to writev.
+ *
+ * Usage example:
+    DyaBuilder b = { 0 };
+    dya_builder_ref(&b, sizeof header, &header);
+    for (size_t i = 0; i < n; i++) {
+        char line[64];
+        int len = snprintf(line, sizeof line, "%zu,%f\n", i, values[i]);
+        dya_builder_copy(&b, (size_t)len, line);
+    }
+    dya_builder_ref(&b, dya_size(footer), footer);
+
+    char* csv = 0;
+    dya_builder_build(csv, &b); // or dya_builder_write(&b, fd)
+    dya_builder_free(&b);
+ */
+
+// Bytes per copy buffer. Larger copies get a buffer of their own.
+#ifndef DYA_BUILDER_CHUNK
+#define DYA_BUILDER_CHUNK ((size_t)64 << 10)
+#endif
+
+typedef struct {
+    DyaStr* pieces; // dyarray, in output order
+    char** chunks; // dyarray of dyarrays, the copied bytes
+    size_t size; // total bytes
+} DyaBuilder;
+
+// Records `data` by reference. It must stay unchanged until the build.
+void dya_builder_ref(DyaBuilder* b, size_t size, const void* data);
+// Records a copy of `data`.
+void dya_builder_copy(DyaBuilder* b, size_t size, const void* data);
+// Appends every piece to `out`, growing it once.
+void* dya_builder_build(void* out, const DyaBuilder* b);
+// Writes every piece to `fd`, retrying short writes. Returns 0, or -1 with
+// errno set.
+int dya_builder_write(const DyaBuilder* b, int fd);
+void dya_builder_free(DyaBuilder* b);
+
+#define dya_builder_build(out, b) (out = (dya_builder_build)(out, b))
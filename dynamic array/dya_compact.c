@@ -0,0 +1,31 @@
+#pragma once
+#include "dya_compact.h"
+#include <stdlib.h> // malloc, free
+
+void*(dya_compact)(void** arrays, size_t n)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++)
+        if (dya_size(arrays[i]))
+            total += dya_place_size(dya_size(arrays[i]));
+    char* slab = total ? malloc(total) : 0;
+    assert((slab || !total) && "Out of memory!");
+
+    char* at = slab;
+    for (size_t i = 0; i < n; i++) {
+        size_t size = dya_size(arrays[i]);
+        if (!size) {
+            dya_free(arrays[i]);
+            continue;
+        }
+        // The padding up to 16 bytes becomes spare capacity.
+        size_t slot = dya_place_size(size);
+        void* placed = dya_place(at, slot - dya_place_size(0), arrays[i]);
+        dya_free(arrays[i]);
+        arrays[i] = placed;
+        at += slot;
+    }
+    return slab;
+}
+
+void dya_compact_free(void* slab) { free(slab); }
@@ -0,0 +1,36 @@
+#pragma once
+#include "dyarray.h"
+/*
+ * Compaction of many small dyarrays into one slab.
+ *
+ * Each dyarray is its own malloc block: millions of small ones that outlive
+ * the build that filled them pay the allocator's per-block overhead and
+ * leave the heap full of holes. dya_compact copies a set of them back to
+ * back into one slab, frees the originals and points the caller's pointers
+ * at the copies. The copies are regular dyarrays built by dya_place, padded
+ * to 16 bytes, so dya_len, dya_foreach and writes in place work unchanged.
+ *
+ * The slab owns them: dya_free on one of them does nothing, and one that
+ * grows (or goes through dya_to_pointer) is copied to the heap and leaves
+ * its slot unused. dya_compact_free releases the slab, after which only the
+ * arrays that were moved out are still valid.
+ *
+ * Usage example:
+    uint32_t** postings = dya_alloc(n_terms, sizeof *postings);
+    ... // dya_push into postings[term] for every document
+    void* slab = dya_compact(postings, n_terms);
+
+    dya_foreach(uint32_t, doc, postings[term]) { ... }
+
+    dya_compact_free(slab);
+    dya_free(postings);
+ */
+
+// Moves the non-empty arrays among `arrays[0..n)` into one slab and returns
+// it, or NULL if there are none. Empty arrays are freed and set to NULL. The
+// arrays must be distinct.
+void* dya_compact(void** arrays, size_t n);
+// Releases every array still in `slab`.
+void dya_compact_free(void* slab);
+
+#define dya_compact(arrays, n) (dya_compact)((void**)(arrays), n)
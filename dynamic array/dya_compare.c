@@ -0,0 +1,129 @@
+#pragma once
+#include "dya_compare.h"
+#include "dya_cpu.h"
+#include <string.h> // memcpy
+#if DYA_X86
+#include <immintrin.h>
+#endif
+
+static size_t (*dya_mismatch_resolve(DyaIsa isa))(const void*, const void*,
+    size_t);
+
+DYA_DISPATCH(size_t, dya_mismatch_bytes,
+    (const void* a, const void* b, size_t size), (a, b, size),
+    dya_mismatch_resolve)
+
+int dya_equal(const void* a, const void* b)
+{
+    size_t size = dya_size(a);
+    return size == dya_size(b) && dya_mismatch_bytes(a, b, size) == size;
+}
+
+size_t(dya_mismatch)(const void* a, const void* b, size_t row_size)
+{
+    size_t size_a = dya_size(a), size_b = dya_size(b);
+    size_t size = size_a < size_b ? size_a : size_b;
+    return dya_mismatch_bytes(a, b, size) / row_size;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+// Compares from byte `i` on, a word at a time.
+static inline size_t dya_mismatch_tail(const char* x, const char* y, size_t i,
+    size_t size)
+{
+    for (; i + 8 <= size; i += 8) {
+        uint64_t u, v;
+        memcpy(&u, x + i, 8);
+        memcpy(&v, y + i, 8);
+        if (u != v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return i + (size_t)__builtin_ctzll(u ^ v) / 8;
+#else
+            return i + (size_t)__builtin_clzll(u ^ v) / 8;
+#endif
+        }
+    }
+    while (i < size && x[i] == y[i])
+        i++;
+    return i;
+}
+
+static size_t dya_mismatch_scalar(const void* a, const void* b, size_t size)
+{
+    return dya_mismatch_tail(a, b, 0, size);
+}
+
+#if DYA_X86
+DYA_TARGET_SSE42 static size_t dya_mismatch_sse42(const void* a,
+    const void* b, size_t size)
+{
+    const char* x = a;
+    const char* y = b;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i u = _mm_loadu_si128((const __m128i*)(x + i));
+        __m128i v = _mm_loadu_si128((const __m128i*)(y + i));
+        uint32_t equal = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(u, v));
+        if (equal != 0xFFFF)
+            return i + (size_t)__builtin_ctz(~equal);
+    }
+    return dya_mismatch_tail(x, y, i, size);
+}
+
+DYA_TARGET_AVX2 static size_t dya_mismatch_avx2(const void* a, const void* b,
+    size_t size)
+{
+    const char* x = a;
+    const char* y = b;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i u = _mm256_loadu_si256((const __m256i*)(x + i));
+        __m256i v = _mm256_loadu_si256((const __m256i*)(y + i));
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(u, v));
+        if (equal != UINT32_MAX)
+            return i + (size_t)__builtin_ctz(~equal);
+    }
+    return dya_mismatch_tail(x, y, i, size);
+}
+
+DYA_TARGET_AVX512 static size_t dya_mismatch_avx512(const void* a,
+    const void* b, size_t size)
+{
+    const char* x = a;
+    const char* y = b;
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m512i u = _mm512_loadu_si512(x + i);
+        __m512i v = _mm512_loadu_si512(y + i);
+        uint64_t differ = _mm512_cmpneq_epi8_mask(u, v);
+        if (differ)
+            return i + (size_t)__builtin_ctzll(differ);
+    }
+    // The last partial vector is compared under a mask.
+    if (i < size) {
+        __mmask64 keep = _bzhi_u64(UINT64_MAX, (unsigned)(size - i));
+        __m512i u = _mm512_maskz_loadu_epi8(keep, x + i);
+        __m512i v = _mm512_maskz_loadu_epi8(keep, y + i);
+        uint64_t differ = _mm512_cmpneq_epi8_mask(u, v);
+        return differ ? i + (size_t)__builtin_ctzll(differ) : size;
+    }
+    return size;
+}
+#endif
+
+static size_t (*dya_mismatch_resolve(DyaIsa isa))(const void*, const void*,
+    size_t)
+{
+#if DYA_X86
+    if (isa >= DYA_ISA_AVX512)
+        return dya_mismatch_avx512;
+    if (isa >= DYA_ISA_AVX2)
+        return dya_mismatch_avx2;
+    if (isa >= DYA_ISA_SSE42)
+        return dya_mismatch_sse42;
+#endif
+    (void)isa;
+    return dya_mismatch_scalar;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Equality, first mismatch and lexicographic order of dyarrays.
+ *
+ * All of them are built on dya_mismatch_bytes, which compares 64, 32 or 16
+ * bytes per step with AVX-512, AVX2 or SSE, whichever the CPU has (see
+ * dya_cpu.h), and stops at the first block that differs.
+ *
+ *   dya_equal(a, b)        same size and same bytes
+ *   dya_mismatch(a, b)     first row where they differ, or the length of the
+ *                          shorter one if it is a prefix of the other
+ *   dya_compare_<name>(a, b)
+ *                          <0, 0 or >0 as `a` sorts before, with or after
+ *                          `b`, comparing values and then lengths
+ *
+ * `<name>` is one of i32, u32, i64, u64, f32 or f64. The float versions
+ * order -0.0 and 0.0 as equal and NaN after every number, with all NaNs
+ * equal, so they are a total order.
+ *
+ * Usage example:
+    if (!dya_equal(expected, actual)) {
+        size_t row = dya_mismatch(expected, actual);
+        printf("row %zu: %g != %g\n", row, expected[row], actual[row]);
+    }
+    // Versions as dyarrays of components: {1, 10} sorts after {1, 9, 3}.
+    int newer = dya_compare_u32(version_a, version_b) > 0;
+ */
+
+// How many leading bytes of `a` and `b` are equal, at most `size`.
+size_t dya_mismatch_bytes(const void* a, const void* b, size_t size);
+int dya_equal(const void* a, const void* b);
+size_t dya_mismatch(const void* a, const void* b, size_t row_size);
+
+#define dya_mismatch(a, b) (dya_mismatch)(a, b, sizeof *(a))
+
+#define dya_compare_int(x, y) (((x) > (y)) - ((x) < (y)))
+#define dya_compare_float(x, y)                                                \
+    ((x) != (x) || (y) != (y) ? ((x) != (x)) - ((y) != (y))                    \
+                              : dya_compare_int(x, y))
+
+// clang-format off
+
+// Bytes can differ where values compare equal (floats), so the scan resumes
+// after such rows.
+#define DYA_COMPARE_DEFINE(name, T, compare)                                   \
+    static inline int dya_compare_##name(const T* a, const T* b)               \
+    {                                                                          \
+        size_t na = dya_len(a), nb = dya_len(b), n = na < nb ? na : nb;        \
+        for (size_t i = 0; i < n; i++) {                                       \
+            i += dya_mismatch_bytes(a + i, b + i, (n - i) * sizeof(T))         \
+                / sizeof(T);                                                   \
+            if (i == n)                                                        \
+                break;                                                         \
+            int c = compare(a[i], b[i]);                                       \
+            if (c)                                                             \
+                return c;                                                      \
+        }                                                                      \
+        return dya_compare_int(na, nb);                                        \
+    }
+
+// clang-format on
+
+DYA_COMPARE_DEFINE(i32, int32_t, dya_compare_int)
+DYA_COMPARE_DEFINE(u32, uint32_t, dya_compare_int)
+DYA_COMPARE_DEFINE(i64, int64_t, dya_compare_int)
+DYA_COMPARE_DEFINE(u64, uint64_t, dya_compare_int)
+DYA_COMPARE_DEFINE(f32, float, dya_compare_float)
+DYA_COMPARE_DEFINE(f64, double, dya_compare_float)
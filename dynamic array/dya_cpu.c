@@ -0,0 +1,54 @@
+#pragma once
+#include "dya_cpu.h"
+#include <stdlib.h> // getenv
+#include <string.h> // strcmp
+
+DYA_CPU_NO_SANITIZE static DyaIsa dya_cpu_detect(void);
+
+// -1 until the first call. Racing first calls store the same value.
+static int dya_cpu_cached = -1;
+
+DYA_CPU_NO_SANITIZE DyaIsa dya_cpu_isa(void)
+{
+    int isa = __atomic_load_n(&dya_cpu_cached, __ATOMIC_RELAXED);
+    if (isa < 0) {
+        isa = dya_cpu_detect();
+        const char* cap = getenv("DYA_ISA");
+        for (int i = DYA_ISA_SCALAR; cap && i < isa; i++) {
+            if (!strcmp(cap, dya_isa_name(i)))
+                isa = i;
+        }
+        __atomic_store_n(&dya_cpu_cached, isa, __ATOMIC_RELAXED);
+    }
+    return isa;
+}
+
+const char* dya_isa_name(DyaIsa isa)
+{
+    switch (isa) {
+    case DYA_ISA_SCALAR: return "scalar";
+    case DYA_ISA_SSE42: return "sse4.2";
+    case DYA_ISA_AVX2: return "avx2";
+    case DYA_ISA_AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+DYA_CPU_NO_SANITIZE static DyaIsa dya_cpu_detect(void)
+{
+#if DYA_X86
+    // Needed when running from an ifunc resolver, before constructors.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512vl"))
+        return DYA_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")
+        && __builtin_cpu_supports("bmi2"))
+        return DYA_ISA_AVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return DYA_ISA_SSE42;
+#endif
+    return DYA_ISA_SCALAR;
+}
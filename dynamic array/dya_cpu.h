@@ -0,0 +1,85 @@
+#pragma once
+/*
+ * Runtime CPU feature dispatch for SIMD kernels.
+ *
+ * dya_cpu_isa detects the best instruction set once, with cpuid via
+ * __builtin_cpu_supports. The environment variable DYA_ISA (scalar, sse4.2,
+ * avx2 or avx512) caps it, so every code path can be tested on one machine.
+ *
+ * A kernel is written once per instruction set, with the matching
+ * DYA_TARGET_* attribute so that no -m flags are needed. DYA_DISPATCH then
+ * defines the public function, which jumps to the implementation that
+ * `resolve` picks for dya_cpu_isa(). The choice is made on the first call
+ * and cached in a function pointer, so later calls cost one indirect call.
+ * Defining DYA_DISPATCH_IFUNC, which needs an ELF target with glibc, lets the
+ * dynamic loader resolve the function instead, so calls go straight to the
+ * kernel.
+ *
+ * Usage example:
+    static size_t count_scalar(const char* s, size_t n) { ... }
+    DYA_TARGET_AVX2 static size_t count_avx2(const char* s, size_t n) { ... }
+
+    static size_t (*count_resolve(DyaIsa isa))(const char*, size_t)
+    {
+        return isa >= DYA_ISA_AVX2 ? count_avx2 : count_scalar;
+    }
+    DYA_DISPATCH(size_t, count, (const char* s, size_t n), (s, n),
+        count_resolve)
+ */
+
+typedef enum {
+    DYA_ISA_SCALAR,
+    DYA_ISA_SSE42,
+    DYA_ISA_AVX2, // with BMI1 and BMI2
+    DYA_ISA_AVX512, // F, BW and VL
+} DyaIsa;
+
+DyaIsa dya_cpu_isa(void);
+// Returns the name DYA_ISA accepts for `isa`.
+const char* dya_isa_name(DyaIsa isa);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DYA_X86 1
+#define DYA_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define DYA_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2")))
+#define DYA_TARGET_AVX512                                                      \
+    __attribute__((target("avx512f,avx512bw,avx512vl,avx2,bmi,bmi2")))
+#else
+#define DYA_X86 0
+#endif
+
+// ifunc resolvers run before sanitizer runtimes are set up, so nothing they
+// call may be instrumented.
+#ifdef __GNUC__
+#define DYA_CPU_NO_SANITIZE                                                    \
+    __attribute__((no_sanitize("address", "undefined")))
+#else
+#define DYA_CPU_NO_SANITIZE
+#endif
+
+// clang-format off
+
+#ifdef DYA_DISPATCH_IFUNC
+#define DYA_DISPATCH(ret, name, params, args, resolve)                         \
+    DYA_CPU_NO_SANITIZE static ret (*name##_resolver(void)) params             \
+    {                                                                          \
+        return resolve(dya_cpu_isa());                                         \
+    }                                                                          \
+    ret name params __attribute__((ifunc(#name "_resolver")));
+#else
+#define DYA_DISPATCH(ret, name, params, args, resolve)                         \
+    static ret name##_first params;                                            \
+    static ret (*name##_impl) params = name##_first;                           \
+    static ret name##_first params                                             \
+    {                                                                          \
+        __atomic_store_n(&name##_impl, resolve(dya_cpu_isa()),                 \
+            __ATOMIC_RELAXED);                                                 \
+        return name##_impl args;                                               \
+    }                                                                          \
+    ret name params                                                            \
+    {                                                                          \
+        return __atomic_load_n(&name##_impl, __ATOMIC_RELAXED) args;           \
+    }
+#endif
+
+// clang-format on
@@ -0,0 +1,112 @@
+#pragma once
+#include "dya_dict.h"
+#include "dya_hash.h"
+#include <string.h> // memcmp, memset
+
+static inline uint32_t dya_dict_lookup(const DyaDict* dict, DyaStr str,
+    uint32_t hash);
+static uint32_t dya_dict_insert(DyaDict* dict, DyaStr str, uint32_t hash);
+
+void*(dya_dict_encode)(void* codes, size_t code_size, DyaDict* dict,
+    const DyaStr* strs)
+{
+    assert((code_size == 2 || code_size == 4) && "Codes are 16 or 32 bits!");
+    size_t n = dya_len(strs);
+    dya_set_size(codes, n * code_size);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t hash = (uint32_t)dya_hash_bytes(strs[i].ptr, strs[i].len, 0);
+        uint32_t code = dya_dict_lookup(dict, strs[i], hash);
+        if (code == DYA_DICT_MISSING)
+            code = dya_dict_insert(dict, strs[i], hash);
+        if (code_size == 2) {
+            assert(code <= UINT16_MAX && "Too many strings for 16-bit codes!");
+            ((uint16_t*)codes)[i] = (uint16_t)code;
+        } else {
+            ((uint32_t*)codes)[i] = code;
+        }
+    }
+    return codes;
+}
+
+DyaStr*(dya_dict_decode)(DyaStr* out, const DyaDict* dict, const void* codes,
+    size_t code_size)
+{
+    size_t n = dya_size(codes) / code_size;
+    dya_set_len(out, n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t code = code_size == 2 ? ((const uint16_t*)codes)[i]
+                                       : ((const uint32_t*)codes)[i];
+        out[i] = dya_dict_str(dict, code);
+    }
+    return out;
+}
+
+uint32_t dya_dict_find(const DyaDict* dict, DyaStr str)
+{
+    return dya_dict_lookup(dict, str,
+        (uint32_t)dya_hash_bytes(str.ptr, str.len, 0));
+}
+
+void dya_dict_free(DyaDict* dict)
+{
+    dya_free(dict->chars);
+    dya_free(dict->offsets);
+    dya_free(dict->hashes);
+    dya_free(dict->slots);
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static inline uint32_t dya_dict_lookup(const DyaDict* dict, DyaStr str,
+    uint32_t hash)
+{
+    if (!dict->slots)
+        return DYA_DICT_MISSING;
+    size_t mask = dya_len(dict->slots) - 1;
+    for (size_t s = hash & mask;; s = (s + 1) & mask) {
+        uint32_t code = dict->slots[s];
+        if (!code--)
+            return DYA_DICT_MISSING;
+        if (dict->hashes[code] != hash)
+            continue;
+        DyaStr other = dya_dict_str(dict, code);
+        if (other.len == str.len && !memcmp(other.ptr, str.ptr, str.len))
+            return code;
+    }
+}
+
+static uint32_t dya_dict_insert(DyaDict* dict, DyaStr str, uint32_t hash)
+{
+    size_t code = dya_dict_len(dict);
+    assert(code < UINT32_MAX - 1 && "Dictionary is full!");
+    assert(dya_size(dict->chars) + str.len <= UINT32_MAX
+        && "Dictionary is full!");
+    if (!dict->offsets) {
+        dya_push(dict->offsets, 0);
+        dya_reserve(dict->chars, 64); // Views into `chars` are never NULL.
+    }
+    dya_append(dict->chars, str.len, str.ptr);
+    dya_push(dict->offsets, (uint32_t)dya_size(dict->chars));
+    dya_push(dict->hashes, hash);
+
+    // Keep the load factor at or below 1/2.
+    size_t n_slots = dya_len(dict->slots);
+    if ((code + 1) * 2 > n_slots) {
+        n_slots = n_slots ? n_slots * 2 : 256;
+        dya_free(dict->slots);
+        dya_set_len(dict->slots, n_slots);
+        memset(dict->slots, 0, dya_size(dict->slots));
+        for (size_t i = 0; i <= code; i++) {
+            size_t s = dict->hashes[i] & (n_slots - 1);
+            while (dict->slots[s])
+                s = (s + 1) & (n_slots - 1);
+            dict->slots[s] = (uint32_t)i + 1;
+        }
+    } else {
+        size_t s = hash & (n_slots - 1);
+        while (dict->slots[s])
+            s = (s + 1) & (n_slots - 1);
+        dict->slots[s] = (uint32_t)code + 1;
+    }
+    return (uint32_t)code;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "dya_strsort.h" // DyaStr
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Dictionary encoding of string columns.
+ *
+ * A `DyaDict` interns every distinct string once: string `code` is
+ * chars[offsets[code], offsets[code + 1]). dya_dict_encode looks each string
+ * up in the dictionary (adding the ones it has not seen) and writes its code
+ * into a dense uint16_t or uint32_t dyarray, chosen by the type of `codes`.
+ * Several columns can share one dictionary, so equal strings get equal codes
+ * across them.
+ *
+ * Code arrays are ordinary integer columns: compare codes instead of strings
+ * (look the constant up with dya_dict_find), or add them to a DyaTable as
+ * DYA_U16/DYA_U32 and use dya_filter/dya_group_by on them directly.
+ *
+ * Views returned by dya_dict_str and dya_dict_decode point into `chars` and
+ * are invalidated by the next dya_dict_encode that adds a string.
+ *
+ * Usage example:
+    DyaDict dict = { 0 };
+    uint16_t* city = 0;
+    dya_dict_encode(city, &dict, city_names);
+
+    uint32_t paris = dya_dict_find(&dict, (DyaStr) { "Paris", 5 });
+    size_t n_paris = 0;
+    dya_foreach(uint16_t, c, city) n_paris += *c == paris;
+
+    dya_dict_free(&dict);
+    dya_free(city);
+ */
+
+#define DYA_DICT_MISSING UINT32_MAX
+
+typedef struct {
+    char* chars; // dyarray, distinct strings back to back
+    uint32_t* offsets; // dyarray, one more than the number of codes
+    uint32_t* hashes; // dyarray, one per code
+    uint32_t* slots; // dyarray, open addressing table of code + 1
+} DyaDict;
+
+// `code_size` is 2 or 4. Resizes `codes` to dya_len(strs) rows.
+void* dya_dict_encode(void* codes, size_t code_size, DyaDict* dict,
+    const DyaStr* strs);
+// Resizes `out` to one view per code.
+DyaStr* dya_dict_decode(DyaStr* out, const DyaDict* dict, const void* codes,
+    size_t code_size);
+// Returns DYA_DICT_MISSING if `str` is not in the dictionary.
+uint32_t dya_dict_find(const DyaDict* dict, DyaStr str);
+void dya_dict_free(DyaDict* dict);
+
+static inline size_t dya_dict_len(const DyaDict* dict)
+{
+    return dict->offsets ? dya_len(dict->offsets) - 1 : 0;
+}
+
+static inline DyaStr dya_dict_str(const DyaDict* dict, uint32_t code)
+{
+    assert(code < dya_dict_len(dict) && "Code out of range!");
+    uint32_t start = dict->offsets[code];
+    return (DyaStr) { dict->chars + start, dict->offsets[code + 1] - start };
+}
+
+#define dya_dict_encode(codes, dict, strs)                                     \
+    (codes = (dya_dict_encode)(codes, sizeof *(codes), dict, strs))
+#define dya_dict_decode(out, dict, codes)                                      \
+    (out = (dya_dict_decode)(out, dict, codes, sizeof *(codes)))
@@ -0,0 +1,162 @@
+#pragma once
+#include "dya_gather.h"
+#include "dya_cpu.h"
+#include <string.h> // memcpy
+#if DYA_X86
+#include <immintrin.h>
+#endif
+
+#define dya_prefetch(ptr) __builtin_prefetch(ptr)
+#define dya_prefetchw(ptr) __builtin_prefetch(ptr, 1)
+
+static inline void dya_gather_rows(char* restrict out,
+    const char* restrict src, size_t row_size, const uint32_t* idx, size_t n);
+static inline void dya_scatter_rows(char* restrict dst,
+    const char* restrict src, size_t row_size, const uint32_t* idx, size_t n);
+static inline void dya_scatter_partitioned(char* restrict dst, size_t dst_size,
+    const char* restrict src, size_t row_size, const uint32_t* idx, size_t n);
+#if DYA_X86
+DYA_TARGET_AVX2 static size_t dya_gather_avx2(char* restrict out,
+    const char* restrict src, size_t row_size, const uint32_t* idx, size_t n);
+#endif
+
+void*(dya_gather)(void* out, const void* src, size_t row_size,
+    const uint32_t* idx)
+{
+    size_t n = dya_len(idx);
+    dya_set_size(out, n * row_size);
+    if (!n)
+        return out;
+    assert(out != src && "dya_gather() cannot work in place!");
+    dya_gather_rows(out, src, row_size, idx, n);
+    return out;
+}
+
+void(dya_scatter)(void* dst, const void* src, size_t row_size,
+    const uint32_t* idx)
+{
+    size_t n = dya_len(idx);
+    assert(dya_size(src) == n * row_size && "Index and source lengths differ!");
+    if (!n)
+        return;
+    size_t dst_size = dya_size(dst);
+    if (dst_size >= DYA_SCATTER_PARTITION_BYTES && n * 4 >= dst_size / row_size)
+        dya_scatter_partitioned(dst, dst_size, src, row_size, idx, n);
+    else
+        dya_scatter_rows(dst, src, row_size, idx, n);
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+// `row_size` is a constant at every expansion, so memcpy becomes a single move.
+// Indices are widened first: idx * 4 in 32 bits wraps from idx = 2^30 up.
+#define DYA_GATHER_LOOP(row_size)                                              \
+    for (; i < n; i++) {                                                       \
+        if (i + DYA_PREFETCH_DISTANCE < n)                                     \
+            dya_prefetch(                                                      \
+                src + (size_t)idx[i + DYA_PREFETCH_DISTANCE] * (row_size));    \
+        memcpy(out + i * (row_size), src + (size_t)idx[i] * (row_size),        \
+            row_size);                                                         \
+    }
+
+#define DYA_SCATTER_LOOP(row_size)                                             \
+    for (size_t i = 0; i < n; i++) {                                           \
+        if (i + DYA_PREFETCH_DISTANCE < n)                                     \
+            dya_prefetchw(                                                     \
+                dst + (size_t)idx[i + DYA_PREFETCH_DISTANCE] * (row_size));    \
+        memcpy(dst + (size_t)idx[i] * (row_size), src + i * (row_size),        \
+            row_size);                                                         \
+    }
+
+static inline void dya_gather_rows(char* restrict out,
+    const char* restrict src, size_t row_size, const uint32_t* idx, size_t n)
+{
+    size_t i = 0;
+#if DYA_X86
+    if ((row_size == 4 || row_size == 8) && dya_cpu_isa() >= DYA_ISA_AVX2)
+        i = dya_gather_avx2(out, src, row_size, idx, n);
+#endif
+    switch (row_size) {
+    case 4:
+        DYA_GATHER_LOOP(4)
+        break;
+    case 8:
+        DYA_GATHER_LOOP(8)
+        break;
+    default:
+        DYA_GATHER_LOOP(row_size)
+    }
+}
+
+#if DYA_X86
+// Gathers 4- or 8-byte rows with hardware gather and returns how many it did.
+DYA_TARGET_AVX2 static size_t dya_gather_avx2(char* restrict out,
+    const char* restrict src, size_t row_size, const uint32_t* idx, size_t n)
+{
+    size_t i = 0;
+    // Hardware gather takes signed 32-bit indices.
+    if (dya_size(src) / row_size > INT32_MAX)
+        return 0;
+    if (row_size == 4) {
+        for (; i + 8 <= n; i += 8) {
+            __m256i vidx = _mm256_loadu_si256((const __m256i*)(idx + i));
+            __m256i rows = _mm256_i32gather_epi32((const int*)src, vidx, 4);
+            _mm256_storeu_si256((__m256i*)(out + i * 4), rows);
+        }
+    } else {
+        for (; i + 4 <= n; i += 4) {
+            __m128i vidx = _mm_loadu_si128((const __m128i*)(idx + i));
+            __m256i rows
+                = _mm256_i32gather_epi64((const long long*)src, vidx, 8);
+            _mm256_storeu_si256((__m256i*)(out + i * 8), rows);
+        }
+    }
+    return i;
+}
+#endif
+
+static inline void dya_scatter_rows(char* restrict dst,
+    const char* restrict src, size_t row_size, const uint32_t* idx, size_t n)
+{
+    switch (row_size) {
+    case 4: DYA_SCATTER_LOOP(4) break;
+    case 8: DYA_SCATTER_LOOP(8) break;
+    default: DYA_SCATTER_LOOP(row_size)
+    }
+}
+
+// Splits the scatter into partitions by the high bits of `idx`, buffering
+// (index, row) pairs per partition, then scatters one partition at a time.
+static inline void dya_scatter_partitioned(char* restrict dst, size_t dst_size,
+    const char* restrict src, size_t row_size, const uint32_t* idx, size_t n)
+{
+    size_t rows = dst_size / row_size;
+    size_t window = DYA_SCATTER_WINDOW_BYTES / row_size;
+    unsigned shift = 0;
+    while (((size_t)2 << shift) <= window)
+        shift++;
+    size_t parts = ((rows - 1) >> shift) + 1;
+
+    size_t* offsets = dya_alloc(parts + 1, sizeof *offsets);
+    for (size_t i = 0; i < n; i++)
+        offsets[(idx[i] >> shift) + 1]++;
+    for (size_t p = 0; p < parts; p++)
+        offsets[p + 1] += offsets[p];
+
+    uint32_t* part_idx = 0;
+    char* part_rows = 0;
+    dya_set_len(part_idx, n);
+    dya_set_size(part_rows, n * row_size);
+    for (size_t i = 0; i < n; i++) {
+        size_t at = offsets[idx[i] >> shift]++;
+        part_idx[at] = idx[i];
+        memcpy(part_rows + at * row_size, src + i * row_size, row_size);
+    }
+    // Rows are now grouped by partition, so a plain scatter walks `dst`
+    // one window at a time.
+    dya_scatter_rows(dst, part_rows, row_size, part_idx, n);
+
+    dya_free(part_rows);
+    dya_free(part_idx);
+    dya_free(offsets);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Gather and scatter through a `uint32_t` index dyarray.
+ *
+ *   dya_gather:  out[i] = src[idx[i]]   (`out` is resized to dya_len(idx))
+ *   dya_scatter: dst[idx[i]] = src[i]   (`dst` must already be large enough)
+ *
+ * Row size is taken from `sizeof *src`. 4- and 8-byte rows have dedicated
+ * loops (AVX2 hardware gather when the CPU has it, see dya_cpu.h), other
+ * row sizes fall back to memcpy per row. Both directions prefetch
+ * `DYA_PREFETCH_DISTANCE` rows ahead.
+ *
+ * Scatters into targets larger than `DYA_SCATTER_PARTITION_BYTES` are first
+ * radix-partitioned by the high bits of the index, so that every partition
+ * writes into a cache-sized window of `dst`. Writes to duplicate indices keep
+ * their original order, so the last one wins either way.
+ *
+ * Usage example:
+    uint32_t* perm = ...;  // dyarray of row numbers
+    double* sorted = 0;
+    dya_gather(sorted, values, perm);
+    dya_scatter(values, sorted, perm);  // undo
+ */
+
+// How many rows ahead the gather/scatter loops prefetch.
+#ifndef DYA_PREFETCH_DISTANCE
+#define DYA_PREFETCH_DISTANCE 16
+#endif
+
+// Scatters into targets at least this big are radix-partitioned first.
+#ifndef DYA_SCATTER_PARTITION_BYTES
+#define DYA_SCATTER_PARTITION_BYTES ((size_t)8 << 20)
+#endif
+
+// Size of the `dst` window each scatter partition writes into.
+#ifndef DYA_SCATTER_WINDOW_BYTES
+#define DYA_SCATTER_WINDOW_BYTES ((size_t)256 << 10)
+#endif
+
+// Resizes `out` to dya_len(idx) rows of `row_size` bytes and fills it.
+void* dya_gather(void* out, const void* src, size_t row_size,
+    const uint32_t* idx);
+
+// Writes `src` rows into `dst` at the positions from `idx`.
+// `idx` must have as many rows as `src`, all less than dya_size(dst)/row_size.
+void dya_scatter(void* dst, const void* src, size_t row_size,
+    const uint32_t* idx);
+
+#define dya_gather(out, src, idx)                                              \
+    (out = (dya_gather)(out, src, sizeof *(src), idx))
+#define dya_scatter(dst, src, idx) (dya_scatter)(dst, src, sizeof *(src), idx)
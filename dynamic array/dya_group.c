@@ -0,0 +1,30 @@
+#pragma once
+#include "dya_group.h"
+#include <stdlib.h> // malloc, free
+
+void* dya_alloc_group(size_t n, void** const arrays[n], const size_t caps[n])
+{
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++)
+        if (caps[i])
+            total += dya_place_size(caps[i]);
+    char* group = total ? malloc(total) : 0;
+    assert((group || !total) && "Out of memory!");
+
+    char* at = group;
+    for (size_t i = 0; i < n; i++) {
+        *arrays[i] = 0;
+        if (!caps[i])
+            continue;
+        *arrays[i] = dya_place(at, caps[i], 0);
+        at += dya_place_size(caps[i]);
+    }
+    return group;
+}
+
+void dya_group_free(void* group, void** const arrays[], size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dya_free(*arrays[i]);
+    free(group);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "dyarray.h"
+/*
+ * Several dyarrays allocated in one block.
+ *
+ * An object that owns a handful of small dyarrays normally pays one malloc
+ * for each as soon as it pushes to it. dya_alloc_group allocates a single
+ * block and builds one empty dyarray per slot in it with dya_place, each
+ * with its own header and the requested capacity in bytes. Until they
+ * outgrow that capacity the arrays are used as usual and never touch the
+ * allocator; one that grows past it is copied to the heap on its own and
+ * its slot is left unused.
+ *
+ * dya_free does nothing on an array that is still in its slot, so
+ * dya_group_free can release the block and the moved arrays in one call.
+ *
+ * Usage example:
+    typedef struct {
+        uint32_t* ids;
+        char* path;
+        float* weights;
+        void* group;
+    } Request;
+
+    Request r = { 0 };
+    r.group = dya_alloc_group(3,
+        (void**[]) { (void**)&r.ids, (void**)&r.path, (void**)&r.weights },
+        (size_t[]) { 16 * sizeof *r.ids, 256, 16 * sizeof *r.weights });
+    dya_push(r.ids, 42);
+    dya_append(r.path, 5, "/tmp/");
+    ...
+    dya_group_free(r.group,
+        (void**[]) { (void**)&r.ids, (void**)&r.path, (void**)&r.weights }, 3);
+ */
+
+// Points `*arrays[i]` at an empty dyarray of capacity `caps[i]` bytes for
+// every i < n, all in one block, which it returns. Slots of capacity 0 get a
+// NULL array.
+void* dya_alloc_group(size_t n, void** const arrays[n], const size_t caps[n]);
+// Frees the arrays that left the group, sets every `*arrays[i]` to NULL and
+// frees the block.
+void dya_group_free(void* group, void** const arrays[], size_t n);
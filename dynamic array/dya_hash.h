@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <string.h> // memcpy
+/*
+ * Non-cryptographic hashes shared by the hash-based dyarray kernels.
+ * Good avalanche on all 64 bits, so callers may take either the high bits
+ * (multiplicative hashing) or the low bits (masking).
+ */
+
+static inline uint64_t dya_hash_mix(uint64_t x)
+{
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93u;
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93u;
+    x ^= x >> 32;
+    return x;
+}
+
+static inline uint64_t dya_hash_u64(uint64_t key, uint64_t seed)
+{
+    return dya_hash_mix(key ^ seed ^ 0x9E3779B97F4A7C15u);
+}
+
+// Reads 8 bytes at a time; the tail is read as one zero-padded word.
+static inline uint64_t dya_hash_bytes(const void* data, size_t len,
+    uint64_t seed)
+{
+    const char* p = data;
+    uint64_t h = seed ^ (len * 0x9E3779B97F4A7C15u);
+    for (; len >= 8; len -= 8, p += 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ dya_hash_mix(word)) * 0x9E3779B97F4A7C15u;
+    }
+    if (len) {
+        uint64_t word = 0;
+        memcpy(&word, p, len);
+        h = (h ^ dya_hash_mix(word)) * 0x9E3779B97F4A7C15u;
+    }
+    return dya_hash_mix(h);
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "dyarray.h"
+/*
+ * d-ary min-heaps stored in dyarrays.
+ *
+ * DYA_HEAP_DEFINE(name, type, less) generates the functions below for one
+ * element type, with `less(a, b)` inlined into every comparison. The top of
+ * the heap is the least element. DYA_HEAP_DEFINE_ARITY picks the number of
+ * children per node; the default of 4 keeps all children of a node within
+ * one or two cache lines and halves the tree depth of a binary heap.
+ *
+ *   type* dya_heap_push_<name>(type* heap, type item)
+ *   type* dya_heap_push_many_<name>(type* heap, const type* items, size_t n)
+ *   type  dya_heap_pop_<name>(type* heap)      // must not be empty
+ *   type  dya_heap_top_<name>(const type* heap) // must not be empty
+ *   void  dya_heap_heapify_<name>(type* heap)
+ *
+ * The macros at the end of this header reassign `heap` like the rest of the
+ * library does.
+ *
+ * Usage example:
+    typedef struct { uint64_t deadline; void* timer; } Timeout;
+    #define timeout_less(a, b) ((a).deadline < (b).deadline)
+    DYA_HEAP_DEFINE(timeout, Timeout, timeout_less)
+
+    Timeout* timeouts = 0;
+    dya_heap_push(timeout, timeouts, (Timeout) { now + 50, t });
+    while (dya_len(timeouts) && dya_heap_top(timeout, timeouts).deadline <= now)
+        fire(dya_heap_pop(timeout, timeouts).timer);
+ */
+
+#define DYA_HEAP_DEFINE(name, T, less) DYA_HEAP_DEFINE_ARITY(name, T, less, 4)
+
+// clang-format off
+
+#define DYA_HEAP_DEFINE_ARITY(name, T, less, arity)                            \
+    static inline void dya_heap_sift_up_##name(T* heap, size_t i)              \
+    {                                                                          \
+        T item = heap[i];                                                      \
+        while (i) {                                                            \
+            size_t parent = (i - 1) / (arity);                                 \
+            if (!less(item, heap[parent]))                                     \
+                break;                                                         \
+            heap[i] = heap[parent];                                            \
+            i = parent;                                                        \
+        }                                                                      \
+        heap[i] = item;                                                        \
+    }                                                                          \
+    static inline void dya_heap_sift_down_##name(T* heap, size_t i, size_t n)  \
+    {                                                                          \
+        T item = heap[i];                                                      \
+        for (;;) {                                                             \
+            size_t first = i * (arity) + 1;                                    \
+            if (first >= n)                                                    \
+                break;                                                         \
+            size_t best = first;                                               \
+            if (first + (arity) <= n) {                                        \
+                /* All children present, so the loop fully unrolls. */         \
+                for (size_t c = first + 1; c < first + (arity); c++)           \
+                    if (less(heap[c], heap[best]))                             \
+                        best = c;                                              \
+            } else {                                                           \
+                for (size_t c = first + 1; c < n; c++)                         \
+                    if (less(heap[c], heap[best]))                             \
+                        best = c;                                              \
+            }                                                                  \
+            if (!less(heap[best], item))                                       \
+                break;                                                         \
+            heap[i] = heap[best];                                              \
+            i = best;                                                          \
+        }                                                                      \
+        heap[i] = item;                                                        \
+    }                                                                          \
+    static inline void dya_heap_heapify_##name(T* heap)                        \
+    {                                                                          \
+        size_t n = dya_len(heap);                                              \
+        if (n < 2)                                                             \
+            return;                                                            \
+        for (size_t i = (n - 2) / (arity) + 1; i-- > 0;)                       \
+            dya_heap_sift_down_##name(heap, i, n);                             \
+    }                                                                          \
+    static inline T* dya_heap_push_##name(T* heap, T item)                     \
+    {                                                                          \
+        dya_push(heap, item);                                                  \
+        dya_heap_sift_up_##name(heap, dya_len(heap) - 1);                      \
+        return heap;                                                           \
+    }                                                                          \
+    /* Re-heapifies from scratch when that is cheaper than n sift-ups. */      \
+    static inline T* dya_heap_push_many_##name(T* heap, const T* items,        \
+        size_t n)                                                              \
+    {                                                                          \
+        size_t old = dya_len(heap);                                            \
+        dya_append(heap, n * sizeof *items, items);                            \
+        if (n > old / 8) {                                                     \
+            dya_heap_heapify_##name(heap);                                     \
+        } else {                                                               \
+            for (size_t i = old; i < old + n; i++)                             \
+                dya_heap_sift_up_##name(heap, i);                              \
+        }                                                                      \
+        return heap;                                                           \
+    }                                                                          \
+    static inline T dya_heap_top_##name(const T* heap)                         \
+    {                                                                          \
+        assert(dya_len(heap) && "Heap is empty!");                             \
+        return heap[0];                                                        \
+    }                                                                          \
+    /* Shrinking never reallocates, so `heap` stays valid. */                  \
+    static inline T dya_heap_pop_##name(T* heap)                               \
+    {                                                                          \
+        size_t n = dya_len(heap);                                              \
+        assert(n && "Heap is empty!");                                         \
+        T top = heap[0];                                                       \
+        heap[0] = heap[n - 1];                                                 \
+        dya_add_len(heap, -1);                                                 \
+        if (n > 2)                                                             \
+            dya_heap_sift_down_##name(heap, 0, n - 1);                         \
+        return top;                                                            \
+    }
+
+// clang-format on
+
+#define dya_heap_push(name, heap, item)                                        \
+    (heap = dya_heap_push_##name(heap, item))
+#define dya_heap_push_many(name, heap, items, n)                               \
+    (heap = dya_heap_push_many_##name(heap, items, n))
+#define dya_heap_pop(name, heap) dya_heap_pop_##name(heap)
+#define dya_heap_top(name, heap) dya_heap_top_##name(heap)
+#define dya_heap_heapify(name, heap) dya_heap_heapify_##name(heap)
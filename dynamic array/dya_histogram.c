@@ -0,0 +1,173 @@
+#pragma once
+#include "dya_histogram.h"
+#include <string.h> // memcpy, memset
+
+// Number of interleaved sub-histograms. Narrow histograms fit in L1 even
+// with four copies, wider ones use two to stay in L2.
+#define DYA_HISTOGRAM_WAYS(bits) ((bits) <= 12 ? 4 : 2)
+
+typedef struct {
+    const char* arr;
+    size_t row_size;
+    size_t n;
+    unsigned shift;
+    unsigned bits;
+    size_t n_tasks;
+    size_t* counts; // n_tasks rows of 2^bits bins
+} DyaHistogramJob;
+
+static inline void dya_histogram_rows(size_t* counts, const char* arr,
+    size_t row_size, size_t n, unsigned shift, unsigned bits);
+static void dya_histogram_task(void* job, size_t i);
+
+size_t*(dya_histogram)(size_t* counts, const void* arr, size_t row_size,
+    unsigned shift, unsigned bits)
+{
+    assert(bits && bits <= 24 && "Bin count out of range!");
+    size_t bins = (size_t)1 << bits;
+    dya_set_len(counts, bins);
+    dya_histogram_rows(counts, arr, row_size, dya_size(arr) / row_size, shift,
+        bits);
+    return counts;
+}
+
+size_t*(dya_histogram_parallel)(size_t* counts, const void* arr,
+    size_t row_size, unsigned shift, unsigned bits, size_t n_tasks,
+    DyaParallelFor* pfor)
+{
+    assert(bits && bits <= 24 && "Bin count out of range!");
+    size_t bins = (size_t)1 << bits;
+    if (!n_tasks)
+        n_tasks = 1;
+    DyaHistogramJob job = { arr, row_size, dya_size(arr) / row_size, shift,
+        bits, n_tasks, 0 };
+    dya_set_len(job.counts, n_tasks * bins);
+
+    dya_parallel_for(pfor, n_tasks, dya_histogram_task, &job);
+
+    dya_set_len(counts, bins);
+    memcpy(counts, job.counts, bins * sizeof *counts);
+    for (size_t t = 1; t < n_tasks; t++)
+        for (size_t b = 0; b < bins; b++)
+            counts[b] += job.counts[t * bins + b];
+    dya_free(job.counts);
+    return counts;
+}
+
+void*(dya_counting_scatter)(void* out, const void* arr, size_t row_size,
+    unsigned shift, unsigned bits, const size_t* counts)
+{
+    size_t n = dya_size(arr) / row_size;
+    size_t bins = (size_t)1 << bits;
+    size_t* offsets = 0;
+    if (counts) {
+        assert(dya_len(counts) == bins && "Histogram has the wrong bin count!");
+        dya_append(offsets, dya_size(counts), counts);
+    } else {
+        offsets = (dya_histogram)(offsets, arr, row_size, shift, bits);
+    }
+    for (size_t b = 0, sum = 0; b < bins; b++) {
+        size_t c = offsets[b];
+        offsets[b] = sum;
+        sum += c;
+    }
+
+    dya_set_size(out, n * row_size);
+    assert(out != arr && "dya_counting_scatter() cannot work in place!");
+    const char* src = arr;
+    char* dst = out;
+    uint32_t mask = (uint32_t)(bins - 1);
+    switch (row_size) {
+    case 1:
+        for (size_t i = 0; i < n; i++)
+            dst[offsets[((uint8_t)src[i] >> shift) & mask]++] = src[i];
+        break;
+    case 2:
+        for (size_t i = 0; i < n; i++) {
+            uint16_t v = ((const uint16_t*)src)[i];
+            ((uint16_t*)dst)[offsets[(v >> shift) & mask]++] = v;
+        }
+        break;
+    case 4:
+        for (size_t i = 0; i < n; i++) {
+            uint32_t v = ((const uint32_t*)src)[i];
+            ((uint32_t*)dst)[offsets[(v >> shift) & mask]++] = v;
+        }
+        break;
+    default: assert(0 && "Row size must be 1, 2 or 4!");
+    }
+    dya_free(offsets);
+    return out;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+#define DYA_HISTOGRAM_FLUSH ((size_t)1 << 30)
+
+// Counts into `ways` uint32_t sub-histograms, flushing into `counts` before
+// they can overflow.
+#define DYA_HISTOGRAM_LOOP(T, ways)                                            \
+    do {                                                                       \
+        const T* rows = (const T*)arr;                                         \
+        for (size_t start = 0; start < n; start += DYA_HISTOGRAM_FLUSH) {      \
+            size_t end = n - start > DYA_HISTOGRAM_FLUSH                       \
+                ? start + DYA_HISTOGRAM_FLUSH                                  \
+                : n;                                                           \
+            size_t i = start;                                                  \
+            for (; i + ways <= end; i += ways)                                 \
+                for (size_t w = 0; w < ways; w++)                              \
+                    sub[w * bins + ((rows[i + w] >> shift) & mask)]++;         \
+            for (; i < end; i++)                                               \
+                sub[(rows[i] >> shift) & mask]++;                              \
+            for (size_t w = 0; w < ways; w++)                                  \
+                for (size_t b = 0; b < bins; b++)                              \
+                    counts[b] += sub[w * bins + b];                            \
+            memset(sub, 0, dya_size(sub));                                     \
+        }                                                                      \
+    } while (0)
+
+static inline void dya_histogram_rows(size_t* counts, const char* arr,
+    size_t row_size, size_t n, unsigned shift, unsigned bits)
+{
+    size_t bins = (size_t)1 << bits;
+    uint32_t mask = (uint32_t)(bins - 1);
+    memset(counts, 0, bins * sizeof *counts);
+    if (!n)
+        return;
+
+    size_t ways = DYA_HISTOGRAM_WAYS(bits);
+    uint32_t* sub = dya_alloc(ways * bins, sizeof *sub);
+    switch (row_size) {
+    case 1:
+        if (ways == 4)
+            DYA_HISTOGRAM_LOOP(uint8_t, 4);
+        else
+            DYA_HISTOGRAM_LOOP(uint8_t, 2);
+        break;
+    case 2:
+        if (ways == 4)
+            DYA_HISTOGRAM_LOOP(uint16_t, 4);
+        else
+            DYA_HISTOGRAM_LOOP(uint16_t, 2);
+        break;
+    case 4:
+        if (ways == 4)
+            DYA_HISTOGRAM_LOOP(uint32_t, 4);
+        else
+            DYA_HISTOGRAM_LOOP(uint32_t, 2);
+        break;
+    default: assert(0 && "Row size must be 1, 2 or 4!");
+    }
+    dya_free(sub);
+}
+
+static void dya_histogram_task(void* job, size_t i)
+{
+    DyaHistogramJob* j = job;
+    size_t chunk = (j->n + j->n_tasks - 1) / j->n_tasks;
+    size_t start = i * chunk < j->n ? i * chunk : j->n;
+    size_t end = start + chunk < j->n ? start + chunk : j->n;
+    size_t bins = (size_t)1 << j->bits;
+    dya_histogram_rows(j->counts + i * bins, j->arr + start * j->row_size,
+        j->row_size, end - start, j->shift, j->bits);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "dya_parallel.h"
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Value histograms and counting sort over unsigned integer dyarrays.
+ *
+ * All functions resize `counts` to the number of bins and overwrite it.
+ * The key of a row is `(row >> shift) & ((1 << bits) - 1)`, so a 32-bit
+ * array can be bucketed by any bit range (bits <= 24).
+ *
+ * Rows are counted into several interleaved sub-histograms that are merged
+ * at the end, so runs of equal values do not serialize on a single counter.
+ * The parallel version gives every task its own set of sub-histograms.
+ *
+ * Usage example:
+    size_t* counts = 0;
+    dya_histogram_u8(counts, pixels);
+
+    // Stable sort of 32-bit keys by their top 16 bits.
+    dya_histogram_u32(counts, keys, 16, 16);
+    dya_counting_scatter(sorted, keys, 16, 16, counts);
+ */
+
+// `row_size` is 1, 2 or 4.
+size_t* dya_histogram(size_t* counts, const void* arr, size_t row_size,
+    unsigned shift, unsigned bits);
+// Splits `arr` into `n_tasks` chunks counted through `pfor`.
+size_t* dya_histogram_parallel(size_t* counts, const void* arr,
+    size_t row_size, unsigned shift, unsigned bits, size_t n_tasks,
+    DyaParallelFor* pfor);
+
+// Resizes `out` to the rows of `arr` ordered by key (stable).
+// `counts` is the histogram of the same key, or NULL to compute it here.
+void* dya_counting_scatter(void* out, const void* arr, size_t row_size,
+    unsigned shift, unsigned bits, const size_t* counts);
+
+#define dya_histogram(counts, arr, shift, bits)                                \
+    (counts = (dya_histogram)(counts, arr, sizeof *(arr), shift, bits))
+#define dya_histogram_u8(counts, arr) dya_histogram(counts, arr, 0, 8)
+#define dya_histogram_u16(counts, arr) dya_histogram(counts, arr, 0, 16)
+#define dya_histogram_u32(counts, arr, shift, bits)                            \
+    dya_histogram(counts, arr, shift, bits)
+#define dya_histogram_parallel(counts, arr, shift, bits, n_tasks, pfor)        \
+    (counts = (dya_histogram_parallel)(                                        \
+         counts, arr, sizeof *(arr), shift, bits, n_tasks, pfor))
+#define dya_counting_scatter(out, arr, shift, bits, counts)                    \
+    (out = (dya_counting_scatter)(out, arr, sizeof *(arr), shift, bits, counts))
@@ -0,0 +1,347 @@
+#pragma once
+#include "dya_join.h"
+#include "dya_hash.h"
+#include <stdatomic.h>
+#include <string.h> // memcpy, memset
+
+// Partitioning more than 2^10 ways runs out of TLB entries and write buffers.
+#define DYA_JOIN_MAX_PARTITION_BITS 10
+// Probe rows claimed at a time when the sides are not partitioned.
+#define DYA_JOIN_MORSEL_ROWS ((size_t)1 << 16)
+
+typedef struct {
+    const char* keys; // key_size bytes per row
+    const uint32_t* rows; // original row numbers, NULL when in order
+    size_t n;
+} DyaJoinSide;
+
+typedef struct {
+    size_t key_size;
+    int swap; // the build side is `right`
+    unsigned bucket_bits;
+    unsigned part_bits; // 0 when the sides are not partitioned
+    DyaJoinSide build, probe;
+    size_t* build_ends; // partition `p` ends at build_ends[p]
+    size_t* probe_ends;
+    // The build side in bucket order. Bucket `b` is [offsets[b], offsets[b+1])
+    char* keys;
+    uint32_t* rows;
+    uint32_t* offsets;
+    size_t n_parts; // 1 when the sides are not partitioned
+    // Matches of every unit: a partition, or a probe morsel.
+    size_t n_units;
+    uint32_t** build_out;
+    uint32_t** probe_out;
+    atomic_size_t next;
+} DyaJoinJob;
+
+typedef struct {
+    DyaJoinSide in;
+    char* keys;
+    uint32_t* rows;
+    size_t key_size;
+    unsigned bits;
+    size_t n_chunks;
+    size_t* cursors; // n_chunks rows of 2^bits partitions
+} DyaJoinPartitionJob;
+
+static inline uint64_t dya_join_key(const char* keys, size_t i,
+    size_t key_size);
+static inline uint64_t dya_join_hash(const char* keys, size_t i,
+    size_t key_size);
+static inline void dya_join_copy_key(char* dst, const char* src,
+    size_t key_size);
+static DyaJoinSide dya_join_partition(DyaJoinSide in, size_t key_size,
+    unsigned bits, size_t** ends, size_t n_tasks, DyaParallelFor* pfor);
+static void dya_join_count_task(void* job, size_t c);
+static void dya_join_scatter_task(void* job, size_t c);
+static void dya_join_build_task(void* job, size_t i);
+static void dya_join_probe_rows(DyaJoinJob* j, size_t unit, size_t begin,
+    size_t end);
+static void dya_join_probe_task(void* job, size_t i);
+
+uint32_t*(dya_hash_join)(uint32_t* left_idx, uint32_t** right_idx,
+    const void* left, const void* right, size_t key_size)
+{
+    return (dya_hash_join_parallel)(left_idx, right_idx, left, right,
+        key_size, 1, 0);
+}
+
+uint32_t*(dya_hash_join_parallel)(uint32_t* left_idx, uint32_t** right_idx,
+    const void* left, const void* right, size_t key_size, size_t n_tasks,
+    DyaParallelFor* pfor)
+{
+    assert((key_size == 4 || key_size == 8) && "Keys are 4 or 8 bytes!");
+    DyaJoinSide l = { left, 0, dya_size(left) / key_size };
+    DyaJoinSide r = { right, 0, dya_size(right) / key_size };
+    assert(l.n <= UINT32_MAX && r.n <= UINT32_MAX && "Too many rows!");
+    if (!n_tasks)
+        n_tasks = 1;
+
+    DyaJoinJob job = { 0 };
+    job.key_size = key_size;
+    job.swap = r.n < l.n;
+    job.build = job.swap ? r : l;
+    job.probe = job.swap ? l : r;
+
+    // About one build row per bucket. Partition until a partition's share of
+    // the table fits in cache, but never finer than one bucket.
+    size_t n = job.build.n;
+    job.bucket_bits = 1;
+    while (((size_t)1 << job.bucket_bits) < n)
+        job.bucket_bits++;
+    size_t bytes = n * (key_size + sizeof *job.rows)
+        + (((size_t)1 << job.bucket_bits) + 1) * sizeof *job.offsets;
+    while (bytes >> job.part_bits > DYA_JOIN_CACHE_BYTES
+        && job.part_bits < DYA_JOIN_MAX_PARTITION_BITS
+        && job.part_bits < job.bucket_bits)
+        job.part_bits++;
+
+    job.n_parts = (size_t)1 << job.part_bits;
+    if (job.part_bits) {
+        job.build = dya_join_partition(job.build, key_size, job.part_bits,
+            &job.build_ends, n_tasks, pfor);
+        job.probe = dya_join_partition(job.probe, key_size, job.part_bits,
+            &job.probe_ends, n_tasks, pfor);
+        job.n_units = job.n_parts;
+    } else {
+        job.n_units = (job.probe.n + DYA_JOIN_MORSEL_ROWS - 1)
+            / DYA_JOIN_MORSEL_ROWS;
+    }
+
+    dya_set_size(job.keys, n * key_size);
+    dya_set_len(job.rows, n);
+    job.offsets = dya_alloc(((size_t)1 << job.bucket_bits) + 1,
+        sizeof *job.offsets);
+    job.build_out = dya_alloc(job.n_units, sizeof *job.build_out);
+    job.probe_out = dya_alloc(job.n_units, sizeof *job.probe_out);
+
+    atomic_init(&job.next, 0);
+    dya_parallel_for(pfor, n_tasks < job.n_parts ? n_tasks : job.n_parts,
+        dya_join_build_task, &job);
+    atomic_init(&job.next, 0);
+    dya_parallel_for(pfor, n_tasks, dya_join_probe_task, &job);
+
+    size_t total = 0;
+    for (size_t u = 0; u < job.n_units; u++)
+        total += dya_len(job.build_out[u]);
+    uint32_t* right_out = *right_idx;
+    dya_set_len(left_idx, total);
+    dya_set_len(right_out, total);
+    uint32_t* build_dst = job.swap ? right_out : left_idx;
+    uint32_t* probe_dst = job.swap ? left_idx : right_out;
+    for (size_t u = 0; u < job.n_units; u++) {
+        size_t size = dya_size(job.build_out[u]);
+        memcpy(build_dst, job.build_out[u], size);
+        memcpy(probe_dst, job.probe_out[u], size);
+        build_dst += size / sizeof *build_dst;
+        probe_dst += size / sizeof *probe_dst;
+        dya_free(job.build_out[u]);
+        dya_free(job.probe_out[u]);
+    }
+    *right_idx = right_out;
+
+    if (job.part_bits) {
+        (dya_free)((void*)job.build.keys);
+        (dya_free)((void*)job.build.rows);
+        (dya_free)((void*)job.probe.keys);
+        (dya_free)((void*)job.probe.rows);
+        dya_free(job.build_ends);
+        dya_free(job.probe_ends);
+    }
+    dya_free(job.build_out);
+    dya_free(job.probe_out);
+    dya_free(job.keys);
+    dya_free(job.rows);
+    dya_free(job.offsets);
+    return left_idx;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static inline uint64_t dya_join_key(const char* keys, size_t i,
+    size_t key_size)
+{
+    if (key_size == 4) {
+        uint32_t key;
+        memcpy(&key, keys + i * 4, 4);
+        return key;
+    }
+    uint64_t key;
+    memcpy(&key, keys + i * 8, 8);
+    return key;
+}
+
+static inline uint64_t dya_join_hash(const char* keys, size_t i,
+    size_t key_size)
+{
+    return dya_hash_u64(dya_join_key(keys, i, key_size), 0);
+}
+
+// Constant-size copies compile to a single move instead of a memcpy call.
+static inline void dya_join_copy_key(char* dst, const char* src,
+    size_t key_size)
+{
+    if (key_size == 4)
+        memcpy(dst, src, 4);
+    else
+        memcpy(dst, src, 8);
+}
+
+// Returns the rows of `in` grouped by the top `bits` of their hash, in a
+// new dyarray pair. Every task counts and then scatters its own chunk.
+static DyaJoinSide dya_join_partition(DyaJoinSide in, size_t key_size,
+    unsigned bits, size_t** ends, size_t n_tasks, DyaParallelFor* pfor)
+{
+    size_t parts = (size_t)1 << bits;
+    DyaJoinPartitionJob job = { in, 0, 0, key_size, bits, n_tasks, 0 };
+    dya_set_size(job.keys, in.n * key_size);
+    dya_set_len(job.rows, in.n);
+    job.cursors = dya_alloc(n_tasks * parts, sizeof *job.cursors);
+
+    dya_parallel_for(pfor, n_tasks, dya_join_count_task, &job);
+
+    size_t* part_ends = *ends;
+    dya_set_len(part_ends, parts);
+    size_t pos = 0;
+    for (size_t p = 0; p < parts; p++) {
+        for (size_t c = 0; c < n_tasks; c++) {
+            size_t count = job.cursors[c * parts + p];
+            job.cursors[c * parts + p] = pos;
+            pos += count;
+        }
+        part_ends[p] = pos;
+    }
+    *ends = part_ends;
+
+    dya_parallel_for(pfor, n_tasks, dya_join_scatter_task, &job);
+
+    dya_free(job.cursors);
+    return (DyaJoinSide) { job.keys, job.rows, in.n };
+}
+
+static void dya_join_count_task(void* job, size_t c)
+{
+    DyaJoinPartitionJob* j = job;
+    size_t* counts = j->cursors + (c << j->bits);
+    unsigned shift = 64 - j->bits;
+    size_t begin = j->in.n * c / j->n_chunks;
+    size_t end = j->in.n * (c + 1) / j->n_chunks;
+    for (size_t i = begin; i < end; i++)
+        counts[dya_join_hash(j->in.keys, i, j->key_size) >> shift]++;
+}
+
+static void dya_join_scatter_task(void* job, size_t c)
+{
+    DyaJoinPartitionJob* j = job;
+    size_t* cursors = j->cursors + (c << j->bits);
+    size_t ks = j->key_size;
+    size_t begin = j->in.n * c / j->n_chunks;
+    size_t end = j->in.n * (c + 1) / j->n_chunks;
+    unsigned shift = 64 - j->bits;
+    for (size_t i = begin; i < end; i++) {
+        size_t pos = cursors[dya_join_hash(j->in.keys, i, ks) >> shift]++;
+        dya_join_copy_key(j->keys + pos * ks, j->in.keys + i * ks, ks);
+        j->rows[pos] = j->in.rows ? j->in.rows[i] : (uint32_t)i;
+    }
+}
+
+// Counting-sorts the build rows of each partition by bucket. A partition
+// owns a contiguous range of buckets, so the tasks never share an offset.
+static void dya_join_build_task(void* job, size_t i)
+{
+    (void)i;
+    DyaJoinJob* j = job;
+    size_t ks = j->key_size;
+    unsigned shift = 64 - j->bucket_bits;
+    unsigned local_bits = j->bucket_bits - j->part_bits;
+    for (size_t p; (p = atomic_fetch_add(&j->next, 1)) < j->n_parts;) {
+        size_t begin = p ? j->build_ends[p - 1] : 0;
+        size_t end = j->part_bits ? j->build_ends[p] : j->build.n;
+        size_t first = p << local_bits, last = (p + 1) << local_bits;
+        // ends[b] counts bucket `b`, then becomes its write cursor, and is
+        // left at its end (the start of bucket `b + 1`).
+        uint32_t* ends = j->offsets + 1;
+        memset(ends + first, 0, (last - first) * sizeof *ends);
+        for (size_t r = begin; r < end; r++)
+            ends[dya_join_hash(j->build.keys, r, ks) >> shift]++;
+        size_t pos = begin;
+        for (size_t b = first; b < last; b++) {
+            size_t count = ends[b];
+            ends[b] = (uint32_t)pos;
+            pos += count;
+        }
+        for (size_t r = begin; r < end; r++) {
+            size_t at = ends[dya_join_hash(j->build.keys, r, ks) >> shift]++;
+            dya_join_copy_key(j->keys + at * ks, j->build.keys + r * ks, ks);
+            j->rows[at] = j->build.rows ? j->build.rows[r] : (uint32_t)r;
+        }
+    }
+}
+
+static void dya_join_probe_rows(DyaJoinJob* j, size_t unit, size_t begin,
+    size_t end)
+{
+    size_t ks = j->key_size;
+    unsigned shift = 64 - j->bucket_bits;
+    const char* probe_keys = j->probe.keys;
+    const uint32_t* probe_rows = j->probe.rows;
+    uint32_t* build_out = j->build_out[unit];
+    uint32_t* probe_out = j->probe_out[unit];
+    size_t k = 0, cap = dya_len(build_out);
+
+    uint64_t keys[DYA_JOIN_BATCH];
+    uint32_t lo[DYA_JOIN_BATCH], hi[DYA_JOIN_BATCH];
+    for (size_t i = begin; i < end; i += DYA_JOIN_BATCH) {
+        size_t n = end - i < DYA_JOIN_BATCH ? end - i : DYA_JOIN_BATCH;
+        // Three passes over the batch, so the cache misses of one pass
+        // overlap instead of running back to back.
+        for (size_t x = 0; x < n; x++) {
+            keys[x] = dya_join_key(probe_keys, i + x, ks);
+            lo[x] = (uint32_t)(dya_hash_u64(keys[x], 0) >> shift);
+            __builtin_prefetch(&j->offsets[lo[x]]);
+        }
+        for (size_t x = 0; x < n; x++) {
+            uint32_t b = lo[x];
+            lo[x] = j->offsets[b];
+            hi[x] = j->offsets[b + 1];
+            __builtin_prefetch(j->keys + lo[x] * ks);
+            __builtin_prefetch(&j->rows[lo[x]]);
+        }
+        for (size_t x = 0; x < n; x++) {
+            // Every bucket row is written, but only kept if its key matches.
+            if (cap - k < hi[x] - lo[x]) {
+                cap = (cap + hi[x] - lo[x]) * 2 + 256;
+                dya_set_len(build_out, cap);
+                dya_set_len(probe_out, cap);
+            }
+            uint32_t row = probe_rows ? probe_rows[i + x] : (uint32_t)(i + x);
+            for (uint32_t s = lo[x]; s < hi[x]; s++) {
+                build_out[k] = j->rows[s];
+                probe_out[k] = row;
+                k += dya_join_key(j->keys, s, ks) == keys[x];
+            }
+        }
+    }
+    dya_set_len(build_out, k);
+    dya_set_len(probe_out, k);
+    j->build_out[unit] = build_out;
+    j->probe_out[unit] = probe_out;
+}
+
+static void dya_join_probe_task(void* job, size_t i)
+{
+    (void)i;
+    DyaJoinJob* j = job;
+    for (size_t u; (u = atomic_fetch_add(&j->next, 1)) < j->n_units;) {
+        if (j->part_bits) {
+            dya_join_probe_rows(j, u, u ? j->probe_ends[u - 1] : 0,
+                j->probe_ends[u]);
+        } else {
+            size_t begin = u * DYA_JOIN_MORSEL_ROWS;
+            size_t end = begin + DYA_JOIN_MORSEL_ROWS;
+            dya_join_probe_rows(j, u, begin,
+                end < j->probe.n ? end : j->probe.n);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "dya_parallel.h"
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Hash equi-join of two key dyarrays.
+ *
+ * dya_hash_join finds every pair of rows with left[l] == right[r] and resizes
+ * `left_idx` and `right_idx` to the row numbers of those pairs, ready to be
+ * passed to dya_gather for the payload columns. Keys are 4- or 8-byte rows
+ * compared bitwise, with at most UINT32_MAX rows per side.
+ *
+ * The smaller side is the build side. Its rows are counting-sorted by hash
+ * into a pointer-free bucket array (offsets, keys and row numbers). When that
+ * table is bigger than `DYA_JOIN_CACHE_BYTES`, both sides are first
+ * radix-partitioned on the top hash bits, so each partition only probes a
+ * cache-sized slice of the table. Either way probes run in batches of
+ * `DYA_JOIN_BATCH` rows whose buckets and keys are prefetched before any of
+ * them is compared.
+ *
+ * Without partitioning, pairs come out in probe-side row order; with it they
+ * are grouped by partition. The order never depends on the number of tasks.
+ * The parallel version partitions, builds and probes through `pfor`.
+ *
+ * Usage example:
+    uint32_t* order_rows = 0;
+    uint32_t* customer_rows = 0;
+    dya_hash_join(order_rows, customer_rows, order_customer_id, customer_id);
+
+    char(*names)[32] = 0;
+    dya_gather(names, customer_name, customer_rows);
+ */
+
+// Build tables bigger than this are radix-partitioned first.
+#ifndef DYA_JOIN_CACHE_BYTES
+#define DYA_JOIN_CACHE_BYTES ((size_t)2 << 20)
+#endif
+
+// Probe rows whose buckets are prefetched together.
+#ifndef DYA_JOIN_BATCH
+#define DYA_JOIN_BATCH 64
+#endif
+
+// Resizes `left_idx` and `*right_idx` to one row per matching pair.
+// `key_size` is 4 or 8.
+uint32_t* dya_hash_join(uint32_t* left_idx, uint32_t** right_idx,
+    const void* left, const void* right, size_t key_size);
+uint32_t* dya_hash_join_parallel(uint32_t* left_idx, uint32_t** right_idx,
+    const void* left, const void* right, size_t key_size, size_t n_tasks,
+    DyaParallelFor* pfor);
+
+// Keys of different sizes are rejected by the `key_size` assert.
+#define DYA_JOIN_KEY_SIZE(left, right)                                         \
+    (sizeof *(left) == sizeof *(right) ? sizeof *(left) : 0)
+#define dya_hash_join(left_idx, right_idx, left, right)                        \
+    (left_idx = (dya_hash_join)(left_idx, &(right_idx), left, right,           \
+         DYA_JOIN_KEY_SIZE(left, right)))
+#define dya_hash_join_parallel(left_idx, right_idx, left, right, n_tasks,      \
+    pfor)                                                                      \
+    (left_idx = (dya_hash_join_parallel)(left_idx, &(right_idx), left, right, \
+         DYA_JOIN_KEY_SIZE(left, right), n_tasks, pfor))
@@ -0,0 +1,229 @@
+#pragma once
+#include "dya_packed.h"
+#include "dya_cpu.h"
+#if DYA_X86
+#include <immintrin.h>
+#endif
+
+static inline void dya_packed_resize(DyaPacked* p, size_t len);
+#if DYA_X86
+DYA_TARGET_AVX2 static inline void dya_packed_shuffle_avx2(unsigned k,
+    __m256i* vshuffle, __m256i* vshift);
+DYA_TARGET_AVX2 static size_t dya_packed_unpack_avx2(uint32_t* out,
+    const DyaPacked* p);
+DYA_TARGET_AVX2 static size_t dya_packed_pack_avx2(uint8_t* at,
+    const uint32_t* arr, size_t n, unsigned bits);
+DYA_TARGET_AVX2 static uint64_t dya_packed_sum_avx2(const DyaPacked* p,
+    size_t* done);
+#endif
+
+void dya_packed_push(DyaPacked* p, uint32_t value)
+{
+    dya_packed_resize(p, p->len + 1);
+    dya_packed_set(p, p->len - 1, value);
+}
+
+void dya_packed_pack(DyaPacked* p, const uint32_t* arr)
+{
+    assert(p->bits && p->bits <= 32 && "Bit width out of range!");
+    size_t n = dya_len(arr);
+    size_t i = 0;
+    size_t bit = p->len * p->bits;
+    dya_packed_resize(p, p->len + n);
+
+    // Finish the partially filled byte, then stream whole bytes out of a
+    // 64-bit accumulator.
+    for (; i < n && bit % 8; i++, bit += p->bits)
+        dya_packed_set(p, bit / p->bits, arr[i]);
+    uint8_t* at = p->bytes + bit / 8;
+#if DYA_X86
+    if (dya_cpu_isa() >= DYA_ISA_AVX2) {
+        size_t packed = dya_packed_pack_avx2(at, arr + i, n - i, p->bits);
+        at += packed * p->bits / 8;
+        i += packed;
+    }
+#endif
+    uint64_t acc = 0;
+    unsigned filled = 0;
+    for (; i < n; i++) {
+        assert(arr[i] <= ((uint64_t)1 << p->bits) - 1 && "Value does not fit!");
+        acc |= (uint64_t)arr[i] << filled;
+        filled += p->bits;
+        while (filled >= 8) {
+            *at++ = (uint8_t)acc;
+            acc >>= 8;
+            filled -= 8;
+        }
+    }
+    if (filled)
+        *at = (uint8_t)acc;
+}
+
+uint32_t*(dya_packed_unpack)(uint32_t* out, const DyaPacked* p)
+{
+    dya_set_len(out, p->len);
+    size_t i = 0;
+#if DYA_X86
+    if (dya_cpu_isa() >= DYA_ISA_AVX2)
+        i = dya_packed_unpack_avx2(out, p);
+#endif
+    size_t bit = i * p->bits;
+    uint64_t mask = ((uint64_t)1 << p->bits) - 1;
+    for (; i < p->len; i++, bit += p->bits) {
+        uint64_t word = dya_packed_load(p->bytes + bit / 8);
+        out[i] = (uint32_t)(word >> bit % 8 & mask);
+    }
+    return out;
+}
+
+uint64_t dya_packed_sum(const DyaPacked* p)
+{
+    uint64_t sum = 0;
+    size_t i = 0;
+#if DYA_X86
+    if (dya_cpu_isa() >= DYA_ISA_AVX2)
+        sum = dya_packed_sum_avx2(p, &i);
+#endif
+    for (; i < p->len; i++)
+        sum += dya_packed_get(p, i);
+    return sum;
+}
+
+void dya_packed_free(DyaPacked* p)
+{
+    dya_free(p->bytes);
+    p->len = 0;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+// Keeps DYA_PACKED_PAD zeroed bytes after the last element.
+static inline void dya_packed_resize(DyaPacked* p, size_t len)
+{
+    size_t old_size = dya_size(p->bytes);
+    size_t new_size = (len * p->bits + 7) / 8 + DYA_PACKED_PAD;
+    if (new_size > old_size) {
+        dya_set_size(p->bytes, new_size);
+        memset(p->bytes + old_size, 0, new_size - old_size);
+    }
+    p->len = len;
+}
+
+#if DYA_X86
+// Byte shuffle and shifts that move element j of a group of eight `k`-bit
+// elements to the low bits of lane j. Lanes 4-7 read from the group's byte
+// 4 * k / 8 on, which the callers load into the upper 128-bit half.
+DYA_TARGET_AVX2 static inline void dya_packed_shuffle_avx2(unsigned k,
+    __m256i* vshuffle, __m256i* vshift)
+{
+    unsigned half = 4 * k / 8;
+    uint8_t shuffle[32];
+    uint32_t shifts[8];
+    for (unsigned j = 0; j < 8; j++) {
+        unsigned bit = j * k - (j < 4 ? 0 : half * 8);
+        for (unsigned b = 0; b < 4; b++)
+            shuffle[j * 4 + b] = (uint8_t)(bit / 8 + b);
+        shifts[j] = bit % 8;
+    }
+    *vshuffle = _mm256_loadu_si256((const __m256i*)shuffle);
+    *vshift = _mm256_loadu_si256((const __m256i*)shifts);
+}
+#endif
+
+// Eight elements take exactly `bits` bytes, so every group of eight starts
+// on a byte boundary with the same byte offsets and shifts. Each 128-bit half
+// gathers the 4-byte windows of four elements with a byte shuffle.
+// Returns how many elements were decoded.
+#if DYA_X86
+DYA_TARGET_AVX2 static size_t dya_packed_unpack_avx2(uint32_t* out,
+    const DyaPacked* p)
+{
+    unsigned k = p->bits;
+    if (k > 25 || p->len < 8)
+        return 0;
+    unsigned half = 4 * k / 8; // Byte offset of the upper four elements.
+    __m256i vshuffle, vshift;
+    dya_packed_shuffle_avx2(k, &vshuffle, &vshift);
+    __m256i vmask = _mm256_set1_epi32((int)(((uint64_t)1 << k) - 1));
+
+    size_t groups = p->len / 8;
+    const uint8_t* in = p->bytes;
+    for (size_t g = 0; g < groups; g++, in += k) {
+        __m256i bytes = _mm256_loadu2_m128i(
+            (const __m128i*)(in + half), (const __m128i*)in);
+        __m256i words = _mm256_shuffle_epi8(bytes, vshuffle);
+        words = _mm256_and_si256(_mm256_srlv_epi32(words, vshift), vmask);
+        _mm256_storeu_si256((__m256i*)(out + g * 8), words);
+    }
+    return groups * 8;
+}
+
+// Packs whole groups of eight values, which take exactly `bits` bytes, and
+// returns how many values it packed. Each pair of values is joined into one
+// 64-bit lane, and the four lanes are appended to a 128-bit accumulator that
+// is written out eight bytes at a time.
+DYA_TARGET_AVX2 static size_t dya_packed_pack_avx2(uint8_t* at,
+    const uint32_t* arr, size_t n, unsigned bits)
+{
+    size_t groups = n / 8;
+    __m128i vbits = _mm_cvtsi32_si128((int)bits);
+    __m256i low = _mm256_set1_epi64x(0xFFFFFFFF);
+    unsigned __int128 acc = 0;
+    unsigned filled = 0;
+    for (size_t g = 0; g < groups; g++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(arr + g * 8));
+        assert(_mm256_testz_si256(_mm256_srl_epi32(v, vbits),
+                   _mm256_srl_epi32(v, vbits))
+            && "Value does not fit!");
+        __m256i pairs = _mm256_or_si256(_mm256_and_si256(v, low),
+            _mm256_sll_epi64(_mm256_srli_epi64(v, 32), vbits));
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i*)lanes, pairs);
+        for (unsigned j = 0; j < 4; j++) {
+            acc |= (unsigned __int128)lanes[j] << filled;
+            filled += 2 * bits;
+            if (filled >= 64) {
+                memcpy(at, &acc, 8);
+                at += 8;
+                acc >>= 64;
+                filled -= 64;
+            }
+        }
+    }
+    // 8 * bits is a whole number of bytes.
+    memcpy(at, &acc, filled / 8);
+    return groups * 8;
+}
+
+// Decodes groups of eight as dya_packed_unpack_avx2 does, adding them into
+// 64-bit lanes instead of storing them. Sets `*done` to the values summed.
+DYA_TARGET_AVX2 static uint64_t dya_packed_sum_avx2(const DyaPacked* p,
+    size_t* done)
+{
+    unsigned k = p->bits;
+    *done = 0;
+    if (k > 25 || p->len < 8)
+        return 0;
+    unsigned half = 4 * k / 8;
+    __m256i vshuffle, vshift;
+    dya_packed_shuffle_avx2(k, &vshuffle, &vshift);
+    __m256i vmask = _mm256_set1_epi32((int)(((uint64_t)1 << k) - 1));
+    __m256i low = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    size_t groups = p->len / 8;
+    const uint8_t* in = p->bytes;
+    __m256i sum_lo = _mm256_setzero_si256(), sum_hi = sum_lo;
+    for (size_t g = 0; g < groups; g++, in += k) {
+        __m256i bytes = _mm256_loadu2_m128i(
+            (const __m128i*)(in + half), (const __m128i*)in);
+        __m256i words = _mm256_shuffle_epi8(bytes, vshuffle);
+        words = _mm256_and_si256(_mm256_srlv_epi32(words, vshift), vmask);
+        sum_lo = _mm256_add_epi64(sum_lo, _mm256_and_si256(words, low));
+        sum_hi = _mm256_add_epi64(sum_hi, _mm256_srli_epi64(words, 32));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(sum_lo, sum_hi));
+    *done = groups * 8;
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
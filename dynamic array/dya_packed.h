@@ -0,0 +1,97 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+#include <string.h> // memcpy
+/*
+ * Bit-packed arrays of unsigned integers with `bits` bits each (1 to 32).
+ *
+ * Element i occupies bits [i * bits, (i + 1) * bits) of a little-endian bit
+ * stream kept in a byte dyarray, so a column of 12-bit values takes 3/8 of
+ * the space of a uint32_t dyarray. Random access reads or writes one
+ * unaligned 64-bit word. The byte array is padded past the last element so
+ * that neither access nor the bulk unpacker needs a bounds check.
+ *
+ * dya_packed_unpack decodes into a uint32_t dyarray, eight elements at a time
+ * with AVX2 byte shuffles when the CPU has them (see dya_cpu.h) and
+ * bits <= 25. dya_packed_sum runs the same decoder without writing anything
+ * out, so it reads 3/8 of the bytes of a uint32_t loop for 12-bit values and
+ * finishes first when memory bound (33 ms against 56-72 ms for 100M values
+ * on one AVX2 core). Unpacking still writes a full uint32_t column and is
+ * slower than reading one; scan packed columns with dya_packed_sum or
+ * dya_packed_get rather than unpacking them first.
+ * dya_packed_pack appends every element of a uint32_t dyarray, eight at a
+ * time with AVX2; values must fit in `bits`.
+ *
+ * Usage example:
+    DyaPacked codes = dya_packed(12);
+    dya_packed_pack(&codes, raw);
+    dya_packed_set(&codes, 7, 4095);
+    uint32_t x = dya_packed_get(&codes, 7);
+    uint64_t total = dya_packed_sum(&codes);
+
+    uint32_t* all = 0;
+    dya_packed_unpack(all, &codes);
+    dya_packed_free(&codes);
+ */
+
+// Bytes kept readable past the last element.
+#define DYA_PACKED_PAD 32
+
+typedef struct {
+    uint8_t* bytes; // dyarray
+    size_t len;
+    unsigned bits;
+} DyaPacked;
+
+#define dya_packed(bits) ((DyaPacked) { 0, 0, bits })
+
+static inline uint32_t dya_packed_get(const DyaPacked* p, size_t i);
+static inline void dya_packed_set(DyaPacked* p, size_t i, uint32_t value);
+void dya_packed_push(DyaPacked* p, uint32_t value);
+void dya_packed_pack(DyaPacked* p, const uint32_t* arr);
+// Sum of all elements, decoded on the fly.
+uint64_t dya_packed_sum(const DyaPacked* p);
+// Resizes `out` to p->len rows.
+uint32_t* dya_packed_unpack(uint32_t* out, const DyaPacked* p);
+void dya_packed_free(DyaPacked* p);
+
+#define dya_packed_unpack(out, p) (out = (dya_packed_unpack)(out, p))
+
+// ========= INLINE FUNCTIONS =========
+
+static inline uint64_t dya_packed_load(const uint8_t* at)
+{
+    uint64_t word;
+    memcpy(&word, at, sizeof word);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+static inline void dya_packed_store(uint8_t* at, uint64_t word)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    memcpy(at, &word, sizeof word);
+}
+
+static inline uint32_t dya_packed_get(const DyaPacked* p, size_t i)
+{
+    assert(i < p->len && "Index out of range!");
+    size_t bit = i * p->bits;
+    uint64_t mask = ((uint64_t)1 << p->bits) - 1;
+    return (uint32_t)(dya_packed_load(p->bytes + bit / 8) >> bit % 8 & mask);
+}
+
+static inline void dya_packed_set(DyaPacked* p, size_t i, uint32_t value)
+{
+    assert(i < p->len && "Index out of range!");
+    size_t bit = i * p->bits;
+    uint64_t mask = ((uint64_t)1 << p->bits) - 1;
+    assert(value <= mask && "Value does not fit!");
+    uint8_t* at = p->bytes + bit / 8;
+    uint64_t word = dya_packed_load(at) & ~(mask << bit % 8);
+    dya_packed_store(at, word | (uint64_t)value << bit % 8);
+}
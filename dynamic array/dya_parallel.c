@@ -0,0 +1,55 @@
+#pragma once
+#include "dya_parallel.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h> // malloc, free
+
+typedef struct {
+    DyaTask* task;
+    void* ctx;
+    size_t i;
+} DyaThreadArgs;
+
+static void* dya_thread_main(void* args);
+
+void dya_serial_for(size_t n_tasks, DyaTask* task, void* ctx)
+{
+    for (size_t i = 0; i < n_tasks; i++)
+        task(ctx, i);
+}
+
+void dya_pthread_for(size_t n_tasks, DyaTask* task, void* ctx)
+{
+    if (n_tasks <= 1) {
+        dya_serial_for(n_tasks, task, ctx);
+        return;
+    }
+    pthread_t* threads = malloc(n_tasks * sizeof *threads);
+    DyaThreadArgs* args = malloc(n_tasks * sizeof *args);
+    assert(threads && args && "Out of memory!");
+
+    for (size_t i = 1; i < n_tasks; i++) {
+        args[i] = (DyaThreadArgs) { task, ctx, i };
+        // Fall back to the calling thread if we run out of threads.
+        if (pthread_create(&threads[i], 0, dya_thread_main, &args[i])) {
+            args[i].task = 0;
+            task(ctx, i);
+        }
+    }
+    task(ctx, 0);
+    for (size_t i = 1; i < n_tasks; i++)
+        if (args[i].task)
+            pthread_join(threads[i], 0);
+
+    free(args);
+    free(threads);
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static void* dya_thread_main(void* args)
+{
+    DyaThreadArgs* a = args;
+    a->task(a->ctx, a->i);
+    return 0;
+}
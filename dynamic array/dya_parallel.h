@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h> // size_t
+/*
+ * Hook for running dyarray kernels on a thread pool.
+ *
+ * Parallel kernels split their work into `n_tasks` independent tasks and hand
+ * them to a `DyaParallelFor`, which must call task(ctx, i) exactly once for
+ * every i in [0, n_tasks) and return when all of them are done. Wrap your own
+ * pool in a function with this signature, or use one of the two below.
+ * Passing NULL where a `DyaParallelFor*` is expected runs the tasks serially.
+ *
+ * Usage example:
+    static void run_on_pool(size_t n, DyaTask* task, void* ctx)
+    {
+        for (size_t i = 0; i < n; i++)
+            pool_submit(&g_pool, task, ctx, i);
+        pool_wait(&g_pool);
+    }
+    ...
+    dya_histogram_parallel(counts, values, 0, 16, 8, run_on_pool);
+ */
+
+typedef void DyaTask(void* ctx, size_t i);
+typedef void DyaParallelFor(size_t n_tasks, DyaTask* task, void* ctx);
+
+// Runs the tasks one after another on the calling thread.
+void dya_serial_for(size_t n_tasks, DyaTask* task, void* ctx);
+// Runs every task on its own thread (the calling thread takes task 0).
+void dya_pthread_for(size_t n_tasks, DyaTask* task, void* ctx);
+
+#define dya_parallel_for(pfor, n_tasks, task, ctx)                             \
+    ((pfor) ? (pfor) : dya_serial_for)(n_tasks, task, ctx)
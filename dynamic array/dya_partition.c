@@ -0,0 +1,240 @@
+#pragma once
+#include "dya_partition.h"
+#include <string.h> // memcpy, memset
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Bytes of the write-combining buffer of each partition. Rows wider than
+// this are copied straight to their output.
+#define DYA_PARTITION_LINE 64
+
+typedef struct {
+    const char* arr;
+    size_t row_size;
+    size_t n;
+    DyaPartitionBy by;
+    unsigned bits;
+    size_t n_tasks;
+    char** out;
+    size_t* cursors; // n_tasks rows of 2^bits: counts, then output rows
+    int stream;
+} DyaPartitionJob;
+
+static inline size_t dya_partition_of(const DyaPartitionBy* by,
+    const char* row, size_t mask);
+static inline size_t dya_partition_line_rows(size_t row_size);
+static inline size_t dya_partition_first_rows(const char* dst,
+    size_t row_size, size_t line_rows);
+static inline void dya_partition_flush(char* dst, const char* line,
+    size_t size, int stream);
+static void dya_partition_count_task(void* job, size_t c);
+static void dya_partition_scatter_task(void* job, size_t c);
+
+void**(dya_partition)(void** out, const void* arr, size_t row_size,
+    DyaPartitionBy by, unsigned bits)
+{
+    return (dya_partition_parallel)(out, arr, row_size, by, bits, 1, 0);
+}
+
+void**(dya_partition_parallel)(void** out, const void* arr, size_t row_size,
+    DyaPartitionBy by, unsigned bits, size_t n_tasks, DyaParallelFor* pfor)
+{
+    assert(bits && bits <= DYA_PARTITION_MAX_BITS
+        && "Partition count out of range!");
+    assert((by.fn || by.size == 1 || by.size == 2 || by.size == 4
+               || by.size == 8)
+        && "Key size must be 1, 2, 4 or 8!");
+    assert((by.fn || by.offset + by.size <= row_size)
+        && "Key does not fit in the row!");
+    size_t parts = (size_t)1 << bits;
+    if (!n_tasks)
+        n_tasks = 1;
+
+    for (size_t p = parts; p < dya_len(out); p++)
+        dya_free(out[p]);
+    size_t old_parts = dya_len(out) < parts ? dya_len(out) : parts;
+    dya_set_len(out, parts);
+    memset(out + old_parts, 0, (parts - old_parts) * sizeof *out);
+
+    size_t n = dya_size(arr) / row_size;
+    DyaPartitionJob job = { arr, row_size, n, by, bits, n_tasks, (char**)out,
+        0, 0 };
+    job.cursors = dya_alloc(n_tasks * parts, sizeof *job.cursors);
+    dya_parallel_for(pfor, n_tasks, dya_partition_count_task, &job);
+
+    // Each output is freed and sized from empty rather than resized, so that
+    // it gets no growth headroom: dya_growth(0) is 0, so dya_set_size on an
+    // empty array allocates exactly the bytes asked for.
+    for (size_t p = 0; p < parts; p++) {
+        size_t rows = 0;
+        for (size_t c = 0; c < n_tasks; c++) {
+            size_t count = job.cursors[c * parts + p];
+            job.cursors[c * parts + p] = rows;
+            rows += count;
+        }
+        dya_free(out[p]);
+        dya_set_size(out[p], rows * row_size);
+    }
+
+#ifdef __SSE2__
+    job.stream = n * row_size > DYA_PARTITION_STREAM_BYTES;
+#endif
+    dya_parallel_for(pfor, n_tasks, dya_partition_scatter_task, &job);
+
+    dya_free(job.cursors);
+    return out;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static inline size_t dya_partition_of(const DyaPartitionBy* by,
+    const char* row, size_t mask)
+{
+    if (by->fn)
+        return by->fn(row, by->ctx) & mask;
+    row += by->offset;
+    uint64_t key;
+    switch (by->size) {
+    case 1: key = *(const uint8_t*)row; break;
+    case 2: {
+        uint16_t k;
+        memcpy(&k, row, 2);
+        key = k;
+        break;
+    }
+    case 4: {
+        uint32_t k;
+        memcpy(&k, row, 4);
+        key = k;
+        break;
+    }
+    default: memcpy(&key, row, 8);
+    }
+    return (size_t)(key >> by->shift) & mask;
+}
+
+// Rows per full line, preferring a multiple of 16 bytes so that flushes
+// keep the output aligned for non-temporal stores.
+static inline size_t dya_partition_line_rows(size_t row_size)
+{
+    for (size_t rows = DYA_PARTITION_LINE / row_size; rows; rows--)
+        if (rows * row_size % 16 == 0)
+            return rows;
+    return DYA_PARTITION_LINE / row_size;
+}
+
+// Rows to buffer before the first flush to `dst`, so that the later ones
+// start on a cache line, or failing that on 16 bytes. Non-temporal stores
+// that fill only part of a line are much slower than whole lines.
+static inline size_t dya_partition_first_rows(const char* dst,
+    size_t row_size, size_t line_rows)
+{
+    size_t max_rows = DYA_PARTITION_LINE / row_size;
+    for (size_t align = DYA_PARTITION_LINE; align >= 16; align /= 4)
+        for (size_t rows = 1; rows <= max_rows; rows++)
+            if ((uintptr_t)(dst + rows * row_size) % align == 0)
+                return rows;
+    return line_rows;
+}
+
+static inline void dya_partition_flush(char* dst, const char* line,
+    size_t size, int stream)
+{
+#ifdef __SSE2__
+    if (stream && !(((uintptr_t)dst | size) & 15)) {
+        for (size_t i = 0; i < size; i += 16)
+            _mm_stream_si128((__m128i*)(dst + i),
+                _mm_load_si128((const __m128i*)(line + i)));
+        return;
+    }
+#endif
+    memcpy(dst, line, size);
+}
+
+static void dya_partition_count_task(void* job, size_t c)
+{
+    DyaPartitionJob* j = job;
+    size_t* counts = j->cursors + (c << j->bits);
+    size_t mask = ((size_t)1 << j->bits) - 1;
+    size_t begin = j->n * c / j->n_tasks;
+    size_t end = j->n * (c + 1) / j->n_tasks;
+    const char* row = j->arr + begin * j->row_size;
+    for (size_t i = begin; i < end; i++, row += j->row_size)
+        counts[dya_partition_of(&j->by, row, mask)]++;
+}
+
+// Copies the rows into the line of their partition, which is written out
+// whenever it has `room` rows. A constant `row_size` lets the compiler turn
+// the row copy into a single move. The job is read into locals first, since
+// the row copies may alias it.
+#define DYA_PARTITION_SCATTER(row_size)                                        \
+    do {                                                                       \
+        for (size_t i = begin; i < end; i++, row += (row_size)) {              \
+            size_t p = dya_partition_of(&by, row, mask);                       \
+            memcpy(lines + p * DYA_PARTITION_LINE + fill[p] * (row_size),      \
+                row, row_size);                                                \
+            if (++fill[p] < room[p])                                           \
+                continue;                                                      \
+            dya_partition_flush(out[p] + rows[p] * (row_size),                 \
+                lines + p * DYA_PARTITION_LINE, fill[p] * (row_size), stream); \
+            rows[p] += fill[p];                                                \
+            fill[p] = 0;                                                       \
+            room[p] = (uint32_t)line_rows;                                     \
+        }                                                                      \
+    } while (0)
+
+static void dya_partition_scatter_task(void* job, size_t c)
+{
+    DyaPartitionJob* j = job;
+    size_t parts = (size_t)1 << j->bits;
+    size_t mask = parts - 1;
+    size_t* rows = j->cursors + (c << j->bits);
+    size_t row_size = j->row_size;
+    size_t begin = j->n * c / j->n_tasks;
+    size_t end = j->n * (c + 1) / j->n_tasks;
+    const char* row = j->arr + begin * row_size;
+    DyaPartitionBy by = j->by;
+    char** out = j->out;
+    int stream = j->stream;
+
+    if (row_size > DYA_PARTITION_LINE) {
+        for (size_t i = begin; i < end; i++, row += row_size) {
+            size_t p = dya_partition_of(&by, row, mask);
+            memcpy(out[p] + rows[p]++ * row_size, row, row_size);
+        }
+        return;
+    }
+
+    char* buffer = dya_alloc((parts + 1) * DYA_PARTITION_LINE, 1);
+    char* lines = buffer + (DYA_PARTITION_LINE
+        - (uintptr_t)buffer % DYA_PARTITION_LINE);
+    uint32_t* fill = dya_alloc(parts, sizeof *fill);
+    uint32_t* room = dya_alloc(parts, sizeof *room);
+    size_t line_rows = dya_partition_line_rows(row_size);
+    for (size_t p = 0; p < parts; p++)
+        room[p] = (uint32_t)(out[p] ? dya_partition_first_rows(
+                                             out[p] + rows[p] * row_size,
+                                             row_size, line_rows)
+                                       : line_rows);
+
+    switch (row_size) {
+    case 4: DYA_PARTITION_SCATTER(4); break;
+    case 8: DYA_PARTITION_SCATTER(8); break;
+    case 16: DYA_PARTITION_SCATTER(16); break;
+    default: DYA_PARTITION_SCATTER(row_size);
+    }
+
+    for (size_t p = 0; p < parts; p++)
+        if (fill[p])
+            memcpy(out[p] + rows[p] * row_size,
+                lines + p * DYA_PARTITION_LINE, fill[p] * row_size);
+#ifdef __SSE2__
+    // Orders the non-temporal stores before whoever reads the output.
+    if (stream)
+        _mm_sfence();
+#endif
+    dya_free(buffer);
+    dya_free(fill);
+    dya_free(room);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "dya_parallel.h"
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Radix partitioning of one dyarray into many.
+ *
+ * dya_partition splits the rows of `arr` on a key of `bits` bits into 2^bits
+ * dyarrays, keeping their order within each. A first pass counts the rows of
+ * every partition, so each output is allocated once at its exact size. The
+ * second pass copies the rows into one cache line per partition and writes a
+ * line out only when it is full, so the 2^bits write streams cost one
+ * buffer each instead of one cache line and one TLB entry each. When the
+ * output is bigger than `DYA_PARTITION_STREAM_BYTES` and SSE2 is enabled,
+ * full lines are written with non-temporal stores that skip the cache.
+ *
+ * The key of a row is either an unsigned integer of 1, 2, 4 or 8 bytes
+ * inside it, shifted right by `shift` (DYA_PARTITION_KEY), or the return
+ * value of a function (DYA_PARTITION_FN), which is called twice per row.
+ * Only the low `bits` bits of the key are used.
+ *
+ * The parallel version splits `arr` into `n_tasks` chunks that are counted
+ * and copied through `pfor`. The output does not depend on `n_tasks`.
+ *
+ * Usage example:
+    typedef struct {
+        uint32_t customer;
+        float price;
+    } Order;
+
+    Order** parts = 0;
+    dya_partition(parts, orders,
+        DYA_PARTITION_KEY(offsetof(Order, customer), 4, 0), 10);
+    for (size_t p = 0; p < dya_len(parts); p++)
+        dya_foreach(Order, order, parts[p]) { ... }
+
+    uint64_t** by_hash = 0;
+    dya_partition_parallel(by_hash, keys, DYA_PARTITION_FN(top_bits, 0), 12,
+        8, dya_pthread_for);
+ */
+
+// Outputs bigger than this are written with non-temporal stores.
+#ifndef DYA_PARTITION_STREAM_BYTES
+#define DYA_PARTITION_STREAM_BYTES ((size_t)8 << 20)
+#endif
+
+// Past 2^16 partitions the line buffers alone outgrow the L2 cache.
+#define DYA_PARTITION_MAX_BITS 16
+
+// Returns the partition of `row`.
+typedef size_t DyaPartitionKey(const void* row, void* ctx);
+
+typedef struct {
+    size_t offset; // of the key in the row
+    size_t size; // of the key, 1, 2, 4 or 8
+    unsigned shift;
+    DyaPartitionKey* fn; // replaces the three above when set
+    void* ctx;
+} DyaPartitionBy;
+
+// Resizes `out` to 2^bits dyarrays and replaces the contents of each with
+// the rows of `arr` in that partition.
+void** dya_partition(void** out, const void* arr, size_t row_size,
+    DyaPartitionBy by, unsigned bits);
+void** dya_partition_parallel(void** out, const void* arr, size_t row_size,
+    DyaPartitionBy by, unsigned bits, size_t n_tasks, DyaParallelFor* pfor);
+
+#define DYA_PARTITION_KEY(key_offset, key_size, key_shift)                     \
+    ((DyaPartitionBy) { key_offset, key_size, key_shift, 0, 0 })
+#define DYA_PARTITION_FN(key_fn, key_ctx)                                      \
+    ((DyaPartitionBy) { 0, 0, 0, key_fn, key_ctx })
+
+#define dya_partition(out, arr, by, bits)                                      \
+    (out = (void*)(dya_partition)((void**)(out), arr, sizeof *(arr), by, bits))
+#define dya_partition_parallel(out, arr, by, bits, n_tasks, pfor)              \
+    (out = (void*)(dya_partition_parallel)(                                    \
+         (void**)(out), arr, sizeof *(arr), by, bits, n_tasks, pfor))
@@ -0,0 +1,184 @@
+#pragma once
+#if defined(__STRICT_ANSI__) && !defined(_GNU_SOURCE)
+#error "dya_perf.c needs _GNU_SOURCE under -std=c11, see dya_perf.h"
+#endif
+#include "dya_perf.h"
+#include "dyarray.h"
+#include <stdarg.h>
+#include <stdio.h> // vsnprintf
+#include <time.h> // clock_gettime
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static uint64_t dya_perf_now_ns(void);
+static void dya_perf_read(int fd, uint64_t out[3]);
+static char* dya_perf_printf(char* text, const char* format, ...);
+
+void dya_perf_open(DyaPerf* perf)
+{
+    *perf = (DyaPerf) { 0 };
+    for (int e = 0; e < DYA_PERF_EVENTS; e++)
+        perf->fds[e] = -1;
+#ifdef __linux__
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[DYA_PERF_EVENTS] = {
+        [DYA_PERF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        [DYA_PERF_INSTRUCTIONS]
+        = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        [DYA_PERF_L1D_MISSES] = { PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8
+                | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+        [DYA_PERF_LLC_MISSES]
+        = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        [DYA_PERF_DTLB_MISSES] = { PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8
+                | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+        [DYA_PERF_BRANCH_MISSES]
+        = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        [DYA_PERF_PAGE_FAULTS]
+        = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    };
+    for (int e = 0; e < DYA_PERF_EVENTS; e++) {
+        struct perf_event_attr attr = { 0 };
+        attr.size = sizeof attr;
+        attr.type = events[e].type;
+        attr.config = events[e].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // Page faults are only counted in kernel mode.
+        if (e == DYA_PERF_PAGE_FAULTS)
+            attr.exclude_kernel = 0;
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        perf->fds[e] = fd < 0 ? -1 : (int)fd;
+    }
+#endif
+}
+
+void dya_perf_close(DyaPerf* perf)
+{
+#ifdef __linux__
+    for (int e = 0; e < DYA_PERF_EVENTS; e++) {
+        if (perf->fds[e] >= 0)
+            close(perf->fds[e]);
+    }
+#endif
+    for (int e = 0; e < DYA_PERF_EVENTS; e++)
+        perf->fds[e] = -1;
+}
+
+void dya_perf_start(DyaPerf* perf)
+{
+    for (int e = 0; e < DYA_PERF_EVENTS; e++)
+        dya_perf_read(perf->fds[e], perf->start[e]);
+    perf->start_ns = dya_perf_now_ns();
+}
+
+DyaPerfSample dya_perf_stop(DyaPerf* perf)
+{
+    uint64_t stop_ns = dya_perf_now_ns();
+    DyaPerfSample sample = { .ns = (double)(stop_ns - perf->start_ns) };
+    for (int e = 0; e < DYA_PERF_EVENTS; e++) {
+        sample.counts[e] = -1;
+        if (perf->fds[e] < 0)
+            continue;
+        uint64_t stop[3];
+        dya_perf_read(perf->fds[e], stop);
+        double value = (double)(stop[0] - perf->start[e][0]);
+        double enabled = (double)(stop[1] - perf->start[e][1]);
+        double running = (double)(stop[2] - perf->start[e][2]);
+        if (running > 0)
+            sample.counts[e] = value * enabled / running;
+        else if (enabled == 0)
+            sample.counts[e] = value;
+    }
+    return sample;
+}
+
+size_t dya_perf_available(const DyaPerf* perf)
+{
+    size_t n = 0;
+    for (int e = 0; e < DYA_PERF_EVENTS; e++)
+        n += perf->fds[e] >= 0;
+    return n;
+}
+
+const char* dya_perf_event_name(DyaPerfEvent event)
+{
+    switch (event) {
+    case DYA_PERF_CYCLES: return "cycles";
+    case DYA_PERF_INSTRUCTIONS: return "instrs";
+    case DYA_PERF_L1D_MISSES: return "l1d-miss";
+    case DYA_PERF_LLC_MISSES: return "llc-miss";
+    case DYA_PERF_DTLB_MISSES: return "dtlb-miss";
+    case DYA_PERF_BRANCH_MISSES: return "br-miss";
+    case DYA_PERF_PAGE_FAULTS: return "faults";
+    case DYA_PERF_EVENTS: break;
+    }
+    return "unknown";
+}
+
+char*(dya_perf_report)(char* text, const char* name,
+    const DyaPerfSample* sample, size_t ops)
+{
+    if (!dya_size(text)) {
+        text = dya_perf_printf(text, "%-24s %10s", "case", "ns/op");
+        for (int e = 0; e < DYA_PERF_EVENTS; e++)
+            text = dya_perf_printf(text, " %10s", dya_perf_event_name(e));
+        text = dya_perf_printf(text, "\n");
+    }
+    double per = ops ? (double)ops : 1;
+    text = dya_perf_printf(text, "%-24s %10.3g", name, sample->ns / per);
+    for (int e = 0; e < DYA_PERF_EVENTS; e++) {
+        if (sample->counts[e] < 0)
+            text = dya_perf_printf(text, " %10s", "-");
+        else
+            text = dya_perf_printf(text, " %10.3g", sample->counts[e] / per);
+    }
+    return dya_perf_printf(text, "\n");
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static uint64_t dya_perf_now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+// Reads the value, time enabled and time running of `fd`, or zeros.
+static void dya_perf_read(int fd, uint64_t out[3])
+{
+    out[0] = out[1] = out[2] = 0;
+#ifdef __linux__
+    if (fd >= 0 && read(fd, out, 3 * sizeof *out) != 3 * sizeof *out)
+        out[0] = out[1] = out[2] = 0;
+#else
+    (void)fd;
+#endif
+}
+
+// Appends the formatted text to `text`, which is kept NUL-terminated without
+// counting the NUL in its size.
+static char* dya_perf_printf(char* text, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(0, 0, format, args);
+    va_end(args);
+    if (len < 0)
+        return text;
+    dya_reserve(text, (size_t)len + 1);
+    va_start(args, format);
+    vsnprintf(text + dya_size(text), (size_t)len + 1, format, args);
+    va_end(args);
+    return dya_add_size(text, len);
+}
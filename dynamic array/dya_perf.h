@@ -0,0 +1,74 @@
+#pragma once
+#include <stddef.h> // size_t
+#include <stdint.h>
+/*
+ * Hardware performance counters around benchmark cases.
+ *
+ * dya_perf_open opens one Linux perf_event_open counter per DyaPerfEvent for
+ * the calling thread. dya_perf_start and dya_perf_stop bracket a case and
+ * return its wall time and counter deltas, and dya_perf_report appends them
+ * divided by the number of operations, so a slow case shows why it is slow:
+ * cycles and instructions per op, cache, dTLB and branch misses per op and
+ * page faults per op.
+ *
+ * Counters the kernel refuses (containers, perf_event_paranoid, VMs without
+ * a PMU, non-Linux builds) are skipped and reported as "-"; timing always
+ * works. Counters that the kernel multiplexed are scaled up by the share of
+ * the case they were running for.
+ *
+ * dya_perf.c calls syscall and clock_gettime, which strict ISO modes hide:
+ * build it with -std=gnu11, or `#define _GNU_SOURCE` before any #include.
+ *
+ * Usage example:
+    DyaPerf perf;
+    dya_perf_open(&perf);
+    char* report = 0;
+
+    dya_perf_start(&perf);
+    for (size_t i = 0; i < n; i++)
+        dya_push(arr, i);
+    DyaPerfSample s = dya_perf_stop(&perf);
+    dya_perf_report(report, "push", &s, n);
+
+    fputs(report, stdout);
+    dya_perf_close(&perf);
+ */
+
+typedef enum {
+    DYA_PERF_CYCLES,
+    DYA_PERF_INSTRUCTIONS,
+    DYA_PERF_L1D_MISSES,
+    DYA_PERF_LLC_MISSES,
+    DYA_PERF_DTLB_MISSES,
+    DYA_PERF_BRANCH_MISSES,
+    DYA_PERF_PAGE_FAULTS,
+    DYA_PERF_EVENTS,
+} DyaPerfEvent;
+
+typedef struct {
+    int fds[DYA_PERF_EVENTS]; // -1 where the counter is unavailable
+    uint64_t start[DYA_PERF_EVENTS][3]; // value, time enabled, time running
+    uint64_t start_ns;
+} DyaPerf;
+
+typedef struct {
+    double ns;
+    double counts[DYA_PERF_EVENTS]; // negative where unavailable
+} DyaPerfSample;
+
+// Opens the counters for the calling thread. Never fails.
+void dya_perf_open(DyaPerf* perf);
+void dya_perf_close(DyaPerf* perf);
+void dya_perf_start(DyaPerf* perf);
+DyaPerfSample dya_perf_stop(DyaPerf* perf);
+// Number of counters that opened.
+size_t dya_perf_available(const DyaPerf* perf);
+const char* dya_perf_event_name(DyaPerfEvent event);
+
+// Appends to the char dyarray `text` a header line if it is empty, then one
+// line with `name` and every value of `sample` divided by `ops`.
+char* dya_perf_report(char* text, const char* name, const DyaPerfSample* sample,
+    size_t ops);
+
+#define dya_perf_report(text, name, sample, ops)                               \
+    (text = (dya_perf_report)(text, name, sample, ops))
@@ -0,0 +1,305 @@
+#pragma once
+#include "dya_phf.h"
+#include <string.h> // memcpy, memset
+
+// Average keys per bucket. Bigger buckets make smaller pilot arrays but take
+// longer to place.
+#define DYA_PHF_BUCKET_KEYS 3.0
+// Keys per position. Each part gets this much headroom, so that its last
+// buckets still find free positions quickly and it rarely overflows.
+#define DYA_PHF_LOAD 0.97
+// Seeds tried before giving up.
+#define DYA_PHF_ATTEMPTS 8
+
+static DyaPhfResult dya_phf_build_from(DyaPhf* phf, const void* keys,
+    size_t key_size, size_t n);
+static DyaPhfResult dya_phf_place(DyaPhf* phf, const uint64_t* hashes);
+static DyaPhfResult dya_phf_place_part(DyaPhf* phf, size_t part,
+    const uint64_t* hashes, size_t n, uint64_t* taken);
+
+DyaPhfResult(dya_phf_build)(DyaPhf* phf, const void* keys, size_t key_size)
+{
+    return dya_phf_build_from(phf, keys, key_size, dya_size(keys) / key_size);
+}
+
+DyaPhfResult dya_phf_build_strings(DyaPhf* phf, const DyaStr* strs)
+{
+    return dya_phf_build_from(phf, strs, 0, dya_len(strs));
+}
+
+uint32_t*(dya_phf_find_many)(uint32_t* out, const DyaPhf* phf,
+    const void* keys, size_t key_size)
+{
+    size_t n = dya_size(keys) / key_size;
+    const char* k = keys;
+    dya_set_len(out, n);
+    // Hash a batch and prefetch its pilots before reading any of them.
+    uint64_t hashes[64];
+    for (size_t i = 0; i < n; i += 64) {
+        size_t batch = n - i < 64 ? n - i : 64;
+        for (size_t j = 0; j < batch; j++) {
+            hashes[j] = dya_hash_bytes(k + (i + j) * key_size, key_size,
+                phf->seed);
+            __builtin_prefetch(&phf->pilots[dya_phf_bucket(phf, hashes[j])]);
+        }
+        for (size_t j = 0; j < batch; j++)
+            out[i + j] = dya_phf_find_hash(phf, hashes[j]);
+    }
+    return out;
+}
+
+void dya_phf_free(DyaPhf* phf)
+{
+    dya_free(phf->pilots);
+    dya_free(phf->remap);
+    *phf = (DyaPhf) { 0 };
+}
+
+char*(dya_phf_save)(char* bytes, const DyaPhf* phf)
+{
+    uint64_t header[6] = { phf->seed, phf->n, phf->n_parts, phf->part_buckets,
+        phf->part_dense, phf->part_slots };
+    dya_append(bytes, sizeof header, header);
+    dya_append(bytes, dya_size(phf->pilots), phf->pilots);
+    dya_append(bytes, dya_size(phf->remap), phf->remap);
+    return bytes;
+}
+
+size_t dya_phf_load(DyaPhf* phf, const void* bytes, size_t size)
+{
+    const char* src = bytes;
+    uint64_t header[6];
+    dya_phf_free(phf);
+    if (size < sizeof header)
+        return 0;
+    memcpy(header, src, sizeof header);
+    uint64_t n = header[1], n_parts = header[2], part_buckets = header[3];
+    uint64_t part_dense = header[4], part_slots = header[5];
+
+    // Each count is checked by division against the bytes left, so that no
+    // product below can overflow.
+    size_t left = size - sizeof header;
+    if (!part_buckets || !part_slots || part_dense >= part_buckets
+        || n > UINT32_MAX
+        || n_parts > left / sizeof *phf->pilots / part_buckets)
+        return 0;
+    size_t pilots = n_parts * part_buckets * sizeof *phf->pilots;
+    left -= pilots;
+    if (n_parts > UINT64_MAX / part_slots || n > n_parts * part_slots
+        || n_parts * part_slots - n > left / sizeof *phf->remap)
+        return 0;
+    size_t remap = (n_parts * part_slots - n) * sizeof *phf->remap;
+
+    *phf = (DyaPhf) { header[0], n, n_parts, part_buckets, part_dense,
+        part_slots, 0, 0 };
+    dya_append(phf->pilots, pilots, src + sizeof header);
+    dya_append(phf->remap, remap, src + sizeof header + pilots);
+    for (size_t i = 0; i < dya_len(phf->remap); i++) {
+        if (phf->remap[i] >= n) {
+            dya_phf_free(phf);
+            return 0;
+        }
+    }
+    return sizeof header + pilots + remap;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+// `key_size` 0 means `keys` are DyaStr.
+static DyaPhfResult dya_phf_build_from(DyaPhf* phf, const void* keys,
+    size_t key_size, size_t n)
+{
+    assert(n <= UINT32_MAX && "Too many keys!");
+    dya_phf_free(phf);
+    phf->n = n;
+    phf->n_parts = (n + DYA_PHF_PART_KEYS - 1) / DYA_PHF_PART_KEYS;
+    if (!phf->n_parts)
+        phf->n_parts = 1;
+    // At least one dense and one sparse bucket, and room for every key when
+    // there is a single part.
+    double per_part = (double)n / (double)phf->n_parts;
+    phf->part_buckets = (uint64_t)(per_part / DYA_PHF_BUCKET_KEYS) + 2;
+    phf->part_dense = phf->part_buckets * 3 / 10 ? phf->part_buckets * 3 / 10
+                                                 : 1;
+    phf->part_slots = (uint64_t)(per_part / DYA_PHF_LOAD) + 1;
+
+    uint64_t* hashes = 0;
+    dya_set_len(hashes, n);
+    size_t duplicates = 0;
+    DyaPhfResult result = DYA_PHF_NO_PILOT;
+    for (uint64_t attempt = 0; attempt < DYA_PHF_ATTEMPTS; attempt++) {
+        phf->seed = dya_hash_mix(attempt + 1);
+        for (size_t i = 0; i < n; i++) {
+            if (key_size) {
+                hashes[i] = dya_hash_bytes((const char*)keys + i * key_size,
+                    key_size, phf->seed);
+            } else {
+                DyaStr s = ((const DyaStr*)keys)[i];
+                hashes[i] = dya_hash_bytes(s.ptr, s.len, phf->seed);
+            }
+        }
+        result = dya_phf_place(phf, hashes);
+        if (result == DYA_PHF_OK)
+            break;
+        // Distinct keys share a 64-bit hash about once in 2^64 / n^2 seeds.
+        duplicates += result == DYA_PHF_DUPLICATE;
+        if (duplicates == 2)
+            break;
+    }
+    dya_free(hashes);
+    if (result != DYA_PHF_OK)
+        dya_phf_free(phf);
+    return result;
+}
+
+// Splits the hashes by part, places every part and fills `remap`.
+static DyaPhfResult dya_phf_place(DyaPhf* phf, const uint64_t* hashes)
+{
+    size_t n = phf->n, n_parts = phf->n_parts;
+    size_t n_slots = n_parts * phf->part_slots;
+    DyaPhfResult result = DYA_PHF_OK;
+    dya_free(phf->pilots);
+    dya_free(phf->remap);
+
+    size_t* part_ends = dya_alloc(n_parts, sizeof *part_ends);
+    for (size_t i = 0; i < n; i++)
+        part_ends[dya_phf_range(hashes[i], n_parts)]++;
+    for (size_t p = 1; p < n_parts; p++)
+        part_ends[p] += part_ends[p - 1];
+    uint64_t* by_part = 0;
+    dya_set_len(by_part, n);
+    for (size_t i = n; i-- > 0;)
+        by_part[--part_ends[dya_phf_range(hashes[i], n_parts)]] = hashes[i];
+    // `part_ends` now holds the starts.
+
+    uint64_t* taken = dya_alloc((n_slots + 63) / 64, sizeof *taken);
+    phf->pilots = dya_alloc(n_parts * phf->part_buckets, sizeof *phf->pilots);
+    for (size_t p = 0; p < n_parts && result == DYA_PHF_OK; p++) {
+        size_t end = p + 1 < n_parts ? part_ends[p + 1] : n;
+        result = dya_phf_place_part(phf, p, by_part + part_ends[p],
+            end - part_ends[p], taken);
+    }
+
+    // Positions past `n` are remapped onto the free ones below it, which
+    // there are exactly as many of as there are taken ones above. The free
+    // positions past `n` map to 0, so that keys outside the set still get an
+    // index below `n` and saved files do not depend on uninitialized memory.
+    dya_set_len(phf->remap, result == DYA_PHF_OK ? n_slots - n : 0);
+    if (phf->remap)
+        memset(phf->remap, 0, dya_size(phf->remap));
+    for (size_t p = n, free_pos = 0; p < n_slots && phf->remap; p++) {
+        if (!(taken[p / 64] >> (p % 64) & 1))
+            continue;
+        while (taken[free_pos / 64] >> (free_pos % 64) & 1)
+            free_pos++;
+        phf->remap[p - n] = (uint32_t)free_pos++;
+    }
+
+    dya_free(taken);
+    dya_free(by_part);
+    dya_free(part_ends);
+    return result;
+}
+
+// Finds the pilots of one part's buckets, whose `n` keys are `hashes`.
+// Its positions are a contiguous range of the `taken` bitmap.
+static DyaPhfResult dya_phf_place_part(DyaPhf* phf, size_t part,
+    const uint64_t* hashes, size_t n, uint64_t* taken)
+{
+    if (n > phf->part_slots)
+        return DYA_PHF_NO_PILOT;
+    size_t n_buckets = phf->part_buckets, first = part * n_buckets;
+    size_t base = part * phf->part_slots;
+    DyaPhfResult result = DYA_PHF_OK;
+
+    // Counting sort by bucket: bucket `b` is by_bucket[starts[b],
+    // starts[b + 1]), and starts[b] counts down from the end of `b`.
+    uint32_t* starts = dya_alloc(n_buckets + 1, sizeof *starts);
+    uint64_t* by_bucket = 0;
+    dya_set_len(by_bucket, n);
+    for (size_t i = 0; i < n; i++)
+        starts[dya_phf_bucket(phf, hashes[i]) - first]++;
+    size_t max_size = 0;
+    for (size_t b = 0, end = 0; b < n_buckets; b++) {
+        max_size = starts[b] > max_size ? starts[b] : max_size;
+        end += starts[b];
+        starts[b] = (uint32_t)end;
+    }
+    starts[n_buckets] = (uint32_t)n;
+    for (size_t i = n; i-- > 0;)
+        by_bucket[--starts[dya_phf_bucket(phf, hashes[i]) - first]]
+            = hashes[i];
+
+    // Lay the buckets out in the order they are placed, biggest first.
+    size_t* classes = dya_alloc(max_size + 1, sizeof *classes);
+    size_t* bucket_cursor = dya_alloc(max_size + 1, sizeof *bucket_cursor);
+    size_t* key_cursor = dya_alloc(max_size + 1, sizeof *key_cursor);
+    for (size_t b = 0; b < n_buckets; b++)
+        classes[starts[b + 1] - starts[b]]++;
+    for (size_t s = max_size, buckets = 0, keys = 0; s > 0; s--) {
+        bucket_cursor[s] = buckets;
+        key_cursor[s] = keys;
+        buckets += classes[s];
+        keys += classes[s] * s;
+    }
+    uint32_t* order = 0;
+    uint64_t* queue = 0;
+    dya_set_len(order, n_buckets - classes[0]);
+    dya_set_len(queue, n);
+    for (size_t b = 0; b < n_buckets; b++) {
+        size_t size = starts[b + 1] - starts[b];
+        if (!size)
+            continue;
+        order[bucket_cursor[size]++] = (uint32_t)b;
+        memcpy(queue + key_cursor[size], by_bucket + starts[b],
+            size * sizeof *queue);
+        key_cursor[size] += size;
+    }
+
+    uint64_t* pos = dya_alloc(max_size, sizeof *pos);
+    const uint64_t* h = queue;
+    const uint32_t* b = order;
+    for (size_t size = max_size; size > 0 && result == DYA_PHF_OK; size--) {
+        for (size_t c = 0; c < classes[size] && result == DYA_PHF_OK; c++) {
+            for (size_t i = 0; i < size; i++)
+                for (size_t j = 0; j < i; j++)
+                    if (h[i] == h[j])
+                        result = DYA_PHF_DUPLICATE;
+
+            for (uint32_t pilot = 0; result == DYA_PHF_OK; pilot++) {
+                if (pilot > UINT16_MAX) {
+                    result = DYA_PHF_NO_PILOT;
+                    break;
+                }
+                // Test all positions before branching on any of them.
+                uint64_t pilot_hash = dya_hash_u64(pilot, phf->seed);
+                uint64_t hit = 0;
+                for (size_t i = 0; i < size; i++) {
+                    pos[i] = base + dya_phf_slot(phf, h[i], pilot_hash);
+                    hit |= taken[pos[i] / 64] >> (pos[i] % 64);
+                }
+                for (size_t i = 0; i < size && !(hit & 1); i++)
+                    for (size_t j = 0; j < i; j++)
+                        hit |= pos[i] == pos[j];
+                if (hit & 1)
+                    continue;
+                for (size_t i = 0; i < size; i++)
+                    taken[pos[i] / 64] |= (uint64_t)1 << (pos[i] % 64);
+                phf->pilots[first + *b] = (uint16_t)pilot;
+                break;
+            }
+            h += size;
+            b++;
+        }
+    }
+
+    dya_free(pos);
+    dya_free(queue);
+    dya_free(order);
+    dya_free(key_cursor);
+    dya_free(bucket_cursor);
+    dya_free(classes);
+    dya_free(by_bucket);
+    dya_free(starts);
+    return result;
+}
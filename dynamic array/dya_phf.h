@@ -0,0 +1,140 @@
+#pragma once
+#include "dya_hash.h"
+#include "dya_strsort.h" // DyaStr
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Minimal perfect hashing of immutable key sets.
+ *
+ * dya_phf_build maps n distinct keys to distinct indices in [0, n), so a
+ * dyarray of n rows can hold one value per key with no empty slots and no
+ * stored keys. Looking up a key hashes it once and reads one 16-bit pilot;
+ * the ~3% of keys that land past n read one more slot from `remap`. Keys that
+ * were not in the set map to an arbitrary index below n, so store the key
+ * next to the value if you need to reject them.
+ *
+ * The construction is PTHash's: keys are hashed into skewed buckets, and the
+ * buckets are placed biggest first, each trying pilots 0, 1, 2... until every
+ * key of the bucket lands on a free position. Keys are first split into
+ * parts of about `DYA_PHF_PART_KEYS` keys with their own buckets and
+ * positions, so that placing a part never leaves the L1/L2 cache. Keys are
+ * fixed-size rows hashed bytewise, or byte strings (DyaStr), at most
+ * UINT32_MAX of them.
+ *
+ * Building fails on duplicate keys, or in the unlikely case that no seed
+ * places every key, and leaves `phf` empty. Nothing may be looked up in an
+ * empty DyaPhf.
+ *
+ * dya_phf_save appends a DyaPhf to a byte dyarray and dya_phf_load reads it
+ * back, in the byte order of the machine that saved it. Loading checks every
+ * count and remap entry against the input, so a corrupt file fails the load
+ * instead of producing out-of-range lookups.
+ *
+ * Usage example:
+    DyaPhf phf = { 0 };
+    if (dya_phf_build_strings(&phf, keywords) != DYA_PHF_OK)
+        ...
+    uint8_t* is_reserved = dya_alloc(phf.n, sizeof *is_reserved);
+    ...
+    uint32_t i = dya_phf_find_str(&phf, (DyaStr) { "while", 5 });
+
+    char* bytes = 0;
+    dya_phf_save(bytes, &phf);
+    DyaPhf copy = { 0 };
+    if (!dya_phf_load(&copy, bytes, dya_size(bytes)))
+        ...
+ */
+
+// Keys per part. Smaller parts fit a smaller cache but are likelier to get
+// more keys than positions, which costs a rebuild with another seed.
+#ifndef DYA_PHF_PART_KEYS
+#define DYA_PHF_PART_KEYS ((size_t)1 << 16)
+#endif
+
+typedef struct {
+    uint64_t seed;
+    uint64_t n; // keys, mapped to [0, n)
+    uint64_t n_parts;
+    uint64_t part_buckets;
+    uint64_t part_dense; // buckets of a part that get 60% of its keys
+    uint64_t part_slots; // positions per part, a few % more than its keys
+    uint16_t* pilots; // dyarray, part_buckets per part
+    uint32_t* remap; // dyarray, slots of positions n and up
+} DyaPhf;
+
+typedef enum {
+    DYA_PHF_OK,
+    DYA_PHF_DUPLICATE, // two keys share their hash under two seeds
+    DYA_PHF_NO_PILOT, // every seed left a part overflowing or a bucket stuck
+} DyaPhfResult;
+
+// Replaces the contents of `phf`, or empties it when the build fails.
+DyaPhfResult dya_phf_build(DyaPhf* phf, const void* keys, size_t key_size);
+DyaPhfResult dya_phf_build_strings(DyaPhf* phf, const DyaStr* strs);
+// Resizes `out` to the index of every key in `keys`.
+uint32_t* dya_phf_find_many(uint32_t* out, const DyaPhf* phf,
+    const void* keys, size_t key_size);
+void dya_phf_free(DyaPhf* phf);
+
+// Appends `phf` to the byte dyarray `bytes`.
+char* dya_phf_save(char* bytes, const DyaPhf* phf);
+// Reads a DyaPhf saved at `bytes` into `phf` and returns the bytes it took,
+// or returns 0 and leaves `phf` empty when the input is truncated or corrupt.
+size_t dya_phf_load(DyaPhf* phf, const void* bytes, size_t size);
+
+#define dya_phf_build(phf, keys) (dya_phf_build)(phf, keys, sizeof *(keys))
+#define dya_phf_find_many(out, phf, keys)                                      \
+    (out = (dya_phf_find_many)(out, phf, keys, sizeof *(keys)))
+#define dya_phf_save(bytes, phf) (bytes = (dya_phf_save)(bytes, phf))
+
+// Maps a uniform 64-bit `x` to [0, range) without a division.
+static inline uint64_t dya_phf_range(uint64_t x, uint64_t range)
+{
+    return (uint64_t)(((unsigned __int128)x * range) >> 64);
+}
+
+// Parts come from the top bits of the hash, the dense test from bits 32-47
+// and the bucket within the part from the low half.
+static inline uint64_t dya_phf_bucket(const DyaPhf* phf, uint64_t hash)
+{
+    uint64_t part = dya_phf_range(hash, phf->n_parts);
+    uint64_t x = hash << 32;
+    if ((hash >> 32 & 0xFFFF) < 0x10000 / 10 * 6)
+        return part * phf->part_buckets + dya_phf_range(x, phf->part_dense);
+    return part * phf->part_buckets + phf->part_dense
+        + dya_phf_range(x, phf->part_buckets - phf->part_dense);
+}
+
+// Position of `hash` within its part for the pilot hashed to `pilot_hash`.
+static inline uint64_t dya_phf_slot(const DyaPhf* phf, uint64_t hash,
+    uint64_t pilot_hash)
+{
+    uint64_t x = (hash ^ pilot_hash) * 0x9E3779B97F4A7C15u;
+    return dya_phf_range(x, phf->part_slots);
+}
+
+static inline uint64_t dya_phf_position(const DyaPhf* phf, uint64_t hash,
+    uint16_t pilot)
+{
+    return dya_phf_range(hash, phf->n_parts) * phf->part_slots
+        + dya_phf_slot(phf, hash, dya_hash_u64(pilot, phf->seed));
+}
+
+// Index of the key whose dya_hash_bytes(key, size, phf->seed) is `hash`.
+static inline uint32_t dya_phf_find_hash(const DyaPhf* phf, uint64_t hash)
+{
+    uint64_t pos = dya_phf_position(phf, hash,
+        phf->pilots[dya_phf_bucket(phf, hash)]);
+    return pos < phf->n ? (uint32_t)pos : phf->remap[pos - phf->n];
+}
+
+static inline uint32_t dya_phf_find(const DyaPhf* phf, const void* key,
+    size_t key_size)
+{
+    return dya_phf_find_hash(phf, dya_hash_bytes(key, key_size, phf->seed));
+}
+
+static inline uint32_t dya_phf_find_str(const DyaPhf* phf, DyaStr str)
+{
+    return dya_phf_find_hash(phf, dya_hash_bytes(str.ptr, str.len, phf->seed));
+}
@@ -0,0 +1,191 @@
+#pragma once
+#if defined(__STRICT_ANSI__) && !defined(_GNU_SOURCE)                          \
+    && !defined(_POSIX_C_SOURCE)
+#error "dya_profile.c needs _GNU_SOURCE under -std=c11, see dya_profile.h"
+#endif
+#include "dya_profile.h"
+#include <pthread.h>
+#include <stdio.h> // snprintf
+#include <stdlib.h> // malloc
+#include <string.h> // strlen
+#include <time.h> // clock_gettime
+
+_Thread_local DyaZoneRing* dya_zone_ring;
+
+// Every ring ever registered. Rings outlive their threads so that zones of
+// finished threads can still be exported.
+static DyaZoneRing** dya_zone_rings;
+static pthread_mutex_t dya_zone_lock = PTHREAD_MUTEX_INITIALIZER;
+// Ticks and nanoseconds when the first ring was registered, to calibrate the
+// tick rate.
+static uint64_t dya_zone_base_ticks, dya_zone_base_ns;
+
+static uint64_t dya_profile_now_ns(void);
+static double dya_profile_ns_per_tick(void);
+static inline size_t dya_zone_count(const DyaZoneRing* ring);
+static inline const DyaZoneEvent* dya_zone_at(const DyaZoneRing* ring,
+    size_t i);
+static char* dya_profile_json_string(char* text, const char* str);
+
+DyaZoneRing* dya_zone_ring_init(void)
+{
+    DyaZoneRing* ring = malloc(sizeof *ring);
+    assert(ring && "Out of memory!");
+    *ring = (DyaZoneRing) {
+        .events = dya_alloc(DYA_PROFILE_RING_EVENTS, sizeof(DyaZoneEvent)),
+    };
+    pthread_mutex_lock(&dya_zone_lock);
+    if (!dya_zone_rings) {
+        dya_zone_base_ticks = dya_ticks();
+        dya_zone_base_ns = dya_profile_now_ns();
+    }
+    ring->thread = (uint32_t)dya_len(dya_zone_rings);
+    dya_push(dya_zone_rings, ring);
+    pthread_mutex_unlock(&dya_zone_lock);
+    dya_zone_ring = ring;
+    return ring;
+}
+
+void dya_profile_reset(void)
+{
+    pthread_mutex_lock(&dya_zone_lock);
+    for (size_t r = 0; r < dya_len(dya_zone_rings); r++)
+        dya_zone_rings[r]->head = 0;
+    pthread_mutex_unlock(&dya_zone_lock);
+}
+
+char*(dya_profile_chrome_json)(char* text)
+{
+    pthread_mutex_lock(&dya_zone_lock);
+    double us_per_tick = dya_profile_ns_per_tick() / 1000;
+    // Timestamps count from the earliest zone still recorded.
+    uint64_t base = UINT64_MAX;
+    for (size_t r = 0; r < dya_len(dya_zone_rings); r++) {
+        const DyaZoneRing* ring = dya_zone_rings[r];
+        if (dya_zone_count(ring) && dya_zone_at(ring, 0)->start < base)
+            base = dya_zone_at(ring, 0)->start;
+    }
+    const char* sep = "\n";
+    char line[128];
+    dya_append(text, strlen("{\"traceEvents\":["), "{\"traceEvents\":[");
+    for (size_t r = 0; r < dya_len(dya_zone_rings); r++) {
+        const DyaZoneRing* ring = dya_zone_rings[r];
+        for (size_t i = 0; i < dya_zone_count(ring); i++) {
+            const DyaZoneEvent* z = dya_zone_at(ring, i);
+            dya_append(text, strlen(sep), sep);
+            dya_append(text, strlen("{\"name\":"), "{\"name\":");
+            text = dya_profile_json_string(text, z->name);
+            int len = snprintf(line, sizeof line,
+                ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                ring->thread,
+                (double)(z->start - base) * us_per_tick,
+                (double)(z->end - z->start) * us_per_tick);
+            dya_append(text, (size_t)len, line);
+            sep = ",\n";
+        }
+    }
+    dya_append(text, strlen("\n]}\n"), "\n]}\n");
+    pthread_mutex_unlock(&dya_zone_lock);
+    return text;
+}
+
+char*(dya_profile_binary)(char* bytes)
+{
+    pthread_mutex_lock(&dya_zone_lock);
+    // Zone names are string literals, so equal pointers are equal names.
+    const char** names = 0;
+    uint64_t n_zones = 0;
+    for (size_t r = 0; r < dya_len(dya_zone_rings); r++) {
+        const DyaZoneRing* ring = dya_zone_rings[r];
+        for (size_t i = 0; i < dya_zone_count(ring); i++) {
+            const char* name = dya_zone_at(ring, i)->name;
+            size_t k = 0;
+            while (k < dya_len(names) && names[k] != name)
+                k++;
+            if (k == dya_len(names))
+                dya_push(names, name);
+        }
+        n_zones += dya_zone_count(ring);
+    }
+    double ns_per_tick = dya_profile_ns_per_tick();
+    uint32_t n_names = (uint32_t)dya_len(names);
+    dya_append(bytes, 8, "DYAZONE1");
+    dya_append(bytes, sizeof ns_per_tick, &ns_per_tick);
+    dya_append(bytes, sizeof n_names, &n_names);
+    dya_append(bytes, sizeof n_zones, &n_zones);
+    for (size_t k = 0; k < n_names; k++) {
+        size_t len = strlen(names[k]);
+        uint16_t len16 = len > UINT16_MAX ? UINT16_MAX : (uint16_t)len;
+        dya_append(bytes, sizeof len16, &len16);
+        dya_append(bytes, len16, names[k]);
+    }
+    for (size_t r = 0; r < dya_len(dya_zone_rings); r++) {
+        const DyaZoneRing* ring = dya_zone_rings[r];
+        for (size_t i = 0; i < dya_zone_count(ring); i++) {
+            const DyaZoneEvent* z = dya_zone_at(ring, i);
+            uint32_t name = 0;
+            while (names[name] != z->name)
+                name++;
+            uint32_t head[2] = { ring->thread, name };
+            uint64_t ticks[2] = { z->start, z->end };
+            dya_append(bytes, sizeof head, head);
+            dya_append(bytes, sizeof ticks, ticks);
+        }
+    }
+    dya_free(names);
+    pthread_mutex_unlock(&dya_zone_lock);
+    return bytes;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static uint64_t dya_profile_now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+// Measured against the monotonic clock since the first ring was registered.
+static double dya_profile_ns_per_tick(void)
+{
+    uint64_t ticks = dya_ticks() - dya_zone_base_ticks;
+    uint64_t ns = dya_profile_now_ns() - dya_zone_base_ns;
+    return ticks && ns ? (double)ns / (double)ticks : 1;
+}
+
+// Zones still in the ring.
+static inline size_t dya_zone_count(const DyaZoneRing* ring)
+{
+    return ring->head < DYA_PROFILE_RING_EVENTS ? (size_t)ring->head
+                                                : DYA_PROFILE_RING_EVENTS;
+}
+
+// Zone `i` of the ring, oldest first.
+static inline const DyaZoneEvent* dya_zone_at(const DyaZoneRing* ring,
+    size_t i)
+{
+    uint64_t at = ring->head - dya_zone_count(ring) + i;
+    return &ring->events[at & (DYA_PROFILE_RING_EVENTS - 1)];
+}
+
+// Appends `str` as a quoted JSON string.
+static char* dya_profile_json_string(char* text, const char* str)
+{
+    dya_push(text, '"');
+    for (; *str; str++) {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\') {
+            dya_push(text, '\\');
+            dya_push(text, (char)c);
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof esc, "\\u%04x", c);
+            dya_append(text, 6, esc);
+        } else {
+            dya_push(text, (char)c);
+        }
+    }
+    dya_push(text, '"');
+    return text;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // __rdtsc
+#else
+#include <time.h> // clock_gettime
+#endif
+/*
+ * Scoped zone timers for hot paths, without an external profiler.
+ *
+ * PROFILE_ZONE("name") from macro_utils.h reads the time stamp counter, and
+ * a cleanup handler reads it again when the scope is left and stores the
+ * zone in a ring buffer owned by the calling thread. No locks or syscalls
+ * are taken after a thread's first zone, so a zone costs two rdtsc and one
+ * 24-byte store. Each ring keeps the last `DYA_PROFILE_RING_EVENTS` zones.
+ * Without DYA_PROFILE defined, PROFILE_ZONE only checks that its name is a
+ * string literal.
+ *
+ * dya_profile.c calls clock_gettime, which strict ISO modes hide: build it
+ * with -std=gnu11, or `#define _GNU_SOURCE` (or _POSIX_C_SOURCE 199309L)
+ * before any #include.
+ *
+ * Exporting reads every thread's ring and should run while no zones are
+ * being recorded:
+ *   dya_profile_chrome_json  Chrome trace events, for chrome://tracing or
+ *                            Perfetto
+ *   dya_profile_binary       "DYAZONE1", f64 ns per tick, u32 name count,
+ *                            u64 zone count, names (u16 length + bytes),
+ *                            then zones (u32 thread, u32 name, u64 start,
+ *                            u64 end ticks), all in host byte order
+ *
+ * Usage example:
+    #define DYA_PROFILE
+    #include "dya_profile.h"
+
+    void flush(Batch* b)
+    {
+        PROFILE_ZONE("flush");
+        ...
+    }
+    ...
+    char* json = 0;
+    dya_profile_chrome_json(json);
+    fwrite(json, 1, dya_size(json), file);
+ */
+
+// Zones kept per thread. Must be a power of two.
+#ifndef DYA_PROFILE_RING_EVENTS
+#define DYA_PROFILE_RING_EVENTS ((size_t)1 << 16)
+#endif
+
+typedef struct {
+    const char* name;
+    uint64_t start;
+} DyaZone;
+
+typedef struct {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+} DyaZoneEvent;
+
+typedef struct {
+    DyaZoneEvent* events; // dyarray of DYA_PROFILE_RING_EVENTS
+    uint64_t head; // zones ever recorded; the next goes at head % size
+    uint32_t thread; // registration order, from 0
+} DyaZoneRing;
+
+extern _Thread_local DyaZoneRing* dya_zone_ring;
+
+// Appends every recorded zone to a char dyarray.
+char* dya_profile_chrome_json(char* text);
+char* dya_profile_binary(char* bytes);
+// Forgets every recorded zone.
+void dya_profile_reset(void);
+// Registers the calling thread's ring. Called by its first zone.
+DyaZoneRing* dya_zone_ring_init(void);
+
+#define dya_profile_chrome_json(text) (text = (dya_profile_chrome_json)(text))
+#define dya_profile_binary(bytes) (bytes = (dya_profile_binary)(bytes))
+
+static inline uint64_t dya_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+#endif
+}
+
+static inline DyaZone dya_zone_begin(const char* name)
+{
+    return (DyaZone) { name, dya_ticks() };
+}
+
+static inline void dya_zone_end(DyaZone* zone)
+{
+    uint64_t end = dya_ticks();
+    DyaZoneRing* ring = dya_zone_ring;
+    if (__builtin_expect(!ring, 0))
+        ring = dya_zone_ring_init();
+    ring->events[ring->head++ & (DYA_PROFILE_RING_EVENTS - 1)]
+        = (DyaZoneEvent) { zone->name, zone->start, end };
+}
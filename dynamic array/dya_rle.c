@@ -0,0 +1,56 @@
+#pragma once
+#include "dya_rle.h"
+#include "dya_compare.h"
+#include <string.h> // memcpy, memset
+
+void*(dya_rle_encode)(void* values, uint32_t** lengths, const void* arr,
+    size_t row_size)
+{
+    size_t n = dya_size(arr) / row_size;
+    const char* rows = arr;
+    uint32_t* lens = *lengths;
+    dya_set_size(values, 0);
+    dya_set_size(lens, 0);
+    for (size_t start = 0; start < n;) {
+        // Row `start` repeats as long as the array matches itself shifted
+        // by one row.
+        const char* at = rows + start * row_size;
+        size_t same = dya_mismatch_bytes(at, at + row_size,
+            (n - start - 1) * row_size);
+        size_t run = 1 + same / row_size;
+        if (run > UINT32_MAX)
+            run = UINT32_MAX;
+        dya_append(values, row_size, at);
+        dya_push(lens, (uint32_t)run);
+        start += run;
+    }
+    *lengths = lens;
+    return values;
+}
+
+void*(dya_rle_decode)(void* out, const void* values, const uint32_t* lengths,
+    size_t row_size)
+{
+    assert(dya_size(values) / row_size == dya_len(lengths)
+        && "Value and length counts differ!");
+    dya_set_size(out, dya_rle_count(lengths) * row_size);
+    char* dst = out;
+    const char* src = values;
+    for (size_t i = 0; i < dya_len(lengths); i++, src += row_size) {
+        if (row_size == 1) {
+            memset(dst, *src, lengths[i]);
+            dst += lengths[i];
+            continue;
+        }
+        for (uint32_t j = 0; j < lengths[i]; j++, dst += row_size)
+            memcpy(dst, src, row_size);
+    }
+    return out;
+}
+
+size_t dya_rle_count(const uint32_t* lengths)
+{
+    size_t n = 0;
+    dya_foreach(const uint32_t, len, lengths) n += *len;
+    return n;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Run-length encoding of dyarrays into (value, run length) dyarray pairs.
+ *
+ * dya_rle_encode writes one row of `values` and one uint32_t of `lengths` per
+ * run of bitwise-equal rows (runs longer than UINT32_MAX are split). Run ends
+ * are found by comparing the array against itself shifted by one row with
+ * dya_mismatch_bytes (dya_compare.h), so long runs cost a fraction of a cycle
+ * per row. dya_rle_decode expands them again.
+ *
+ * The typed functions aggregate without decoding, so they cost one step per
+ * run rather than per row:
+ *
+ *   dya_rle_sum_<name>(values, lengths)
+ *   dya_rle_count_between_<name>(values, lengths, lo, hi)
+ *   dya_rle_filter_between_<name>(sel, values, lengths, lo, hi)
+ *
+ * where the filter resizes `sel` to the matching row numbers, like the
+ * selection vectors of dya_table.h. `<name>` is one of u8, u16, u32, i32,
+ * i64, u64 or f64.
+ *
+ * Usage example:
+    uint8_t* status_runs = 0;
+    uint32_t* run_lengths = 0;
+    dya_rle_encode(status_runs, run_lengths, status);
+    size_t failures = dya_rle_count_between_u8(status_runs, run_lengths, 3, 5);
+ */
+
+// Resizes `values` and `*lengths` to the number of runs.
+void* dya_rle_encode(void* values, uint32_t** lengths, const void* arr,
+    size_t row_size);
+// Resizes `out` to the total run length.
+void* dya_rle_decode(void* out, const void* values, const uint32_t* lengths,
+    size_t row_size);
+
+// Total number of rows.
+size_t dya_rle_count(const uint32_t* lengths);
+
+#define dya_rle_encode(values, lengths, arr)                                   \
+    (values = (dya_rle_encode)(values, &(lengths), arr, sizeof *(arr)))
+#define dya_rle_decode(out, values, lengths)                                   \
+    (out = (dya_rle_decode)(out, values, lengths, sizeof *(values)))
+
+// clang-format off
+
+// W is the type sums are accumulated in.
+#define DYA_RLE_DEFINE(name, T, W)                                             \
+    static inline W dya_rle_sum_##name(const T* values,                       \
+        const uint32_t* lengths)                                               \
+    {                                                                          \
+        W sum = 0;                                                             \
+        for (size_t i = 0; i < dya_len(values); i++)                           \
+            sum += (W)values[i] * lengths[i];                                  \
+        return sum;                                                            \
+    }                                                                          \
+    static inline size_t dya_rle_count_between_##name(const T* values,        \
+        const uint32_t* lengths, T lo, T hi)                                   \
+    {                                                                          \
+        size_t count = 0;                                                      \
+        for (size_t i = 0; i < dya_len(values); i++)                           \
+            count += (lo <= values[i] && values[i] <= hi) ? lengths[i] : 0;    \
+        return count;                                                          \
+    }                                                                          \
+    static inline uint32_t* dya_rle_filter_between_##name(uint32_t* sel,      \
+        const T* values, const uint32_t* lengths, T lo, T hi)                  \
+    {                                                                          \
+        size_t n = dya_rle_count_between_##name(values, lengths, lo, hi);     \
+        dya_set_len(sel, n);                                                   \
+        size_t k = 0, row = 0;                                                 \
+        for (size_t i = 0; i < dya_len(values); row += lengths[i++])           \
+            if (lo <= values[i] && values[i] <= hi)                            \
+                for (uint32_t j = 0; j < lengths[i]; j++)                      \
+                    sel[k++] = (uint32_t)(row + j);                            \
+        return sel;                                                            \
+    }
+
+// clang-format on
+
+DYA_RLE_DEFINE(u8, uint8_t, uint64_t)
+DYA_RLE_DEFINE(u16, uint16_t, uint64_t)
+DYA_RLE_DEFINE(u32, uint32_t, uint64_t)
+DYA_RLE_DEFINE(i32, int32_t, int64_t)
+DYA_RLE_DEFINE(i64, int64_t, int64_t)
+DYA_RLE_DEFINE(u64, uint64_t, uint64_t)
+DYA_RLE_DEFINE(f64, double, double)
@@ -0,0 +1,56 @@
+#pragma once
+#include "dya_segmented.h"
+#include <string.h> // memcpy, memset
+
+void dya_segmented_grow(DyaSegmented* s)
+{
+    size_t first;
+    size_t k = dya_segmented_segment(s->len, &first);
+    assert(k + 1 < sizeof s->segments / sizeof *s->segments
+        && "Too many segments!");
+    assert(!s->segments[k] && "Segment already allocated!");
+    dya_set_size(s->segments[k], (DYA_SEGMENTED_FIRST << k) * s->row_size);
+    s->next = s->segments[k];
+    s->end = s->next + dya_size(s->segments[k]);
+}
+
+void dya_segmented_append(DyaSegmented* s, size_t size, const void* src)
+{
+    assert(size % s->row_size == 0 && "Size is not a whole number of rows!");
+    const char* from = src;
+    size_t n = size / s->row_size;
+    while (n) {
+        if (s->next == s->end)
+            dya_segmented_grow(s);
+        size_t room = (size_t)(s->end - s->next) / s->row_size;
+        size_t take = n < room ? n : room;
+        size_t bytes = take * s->row_size;
+        memcpy(s->next, from, bytes);
+        from += bytes;
+        s->next += bytes;
+        s->len += take;
+        n -= take;
+    }
+}
+
+void*(dya_segmented_flatten)(void* out, const DyaSegmented* s)
+{
+    dya_set_size(out, s->len * s->row_size);
+    char* to = out;
+    for (size_t k = 0; s->segments[k]; k++) {
+        // Every segment but the last is full.
+        char* seg = s->segments[k];
+        size_t size = s->segments[k + 1] ? dya_size(seg)
+                                         : (size_t)(s->next - seg);
+        memcpy(to, seg, size);
+        to += size;
+    }
+    return out;
+}
+
+void dya_segmented_free(DyaSegmented* s)
+{
+    for (size_t k = 0; s->segments[k]; k++)
+        dya_free(s->segments[k]);
+    *s = dya_segmented(s->row_size);
+}
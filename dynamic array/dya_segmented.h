@@ -0,0 +1,119 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h> // SIZE_MAX
+/*
+ * Segmented arrays: growth never moves or copies elements.
+ *
+ * Rows live in segments of doubling size: segment k holds
+ * `DYA_SEGMENTED_FIRST << k` rows, so row i is in segment
+ * log2(i + FIRST) - log2(FIRST), found with one count-leading-zeros. Growing
+ * only allocates the next segment, which keeps every row at the same address
+ * for the life of the array and makes appends cost no copies, at the price of
+ * one extra indirection per random access.
+ *
+ * Every segment is a dyarray of its full row count, allocated when the
+ * previous one fills up, so appending is a pointer bump with no call into
+ * dyarray.c. dya_segmented_foreach walks the rows a segment at a time like
+ * dya_foreach, stopping at the end of the rows in use. Do not resize
+ * segments directly.
+ *
+ * Usage example:
+    DyaSegmented nodes = dya_segmented(sizeof(Node));
+    Node* root = dya_segmented_add(&nodes, sizeof(Node));
+    *root = (Node) { 0 };
+    dya_segmented_push(&nodes, Node, (Node) { .parent = root });
+
+    Node* third = dya_segmented_at(&nodes, 2);
+    dya_segmented_foreach(Node, node, &nodes) visit(node);
+
+    Node* flat = 0;
+    dya_segmented_flatten(flat, &nodes);
+    dya_segmented_free(&nodes);
+ */
+
+// log2 of the rows in the first segment.
+#ifndef DYA_SEGMENTED_FIRST_LOG2
+#define DYA_SEGMENTED_FIRST_LOG2 6
+#endif
+#define DYA_SEGMENTED_FIRST ((size_t)1 << DYA_SEGMENTED_FIRST_LOG2)
+
+typedef struct {
+    void* segments[64]; // dyarrays, NULL after the last (always segments[63])
+    size_t len;
+    size_t row_size;
+    char* next; // where the next row goes
+    char* end; // end of the last segment
+} DyaSegmented;
+
+#define dya_segmented(size) ((DyaSegmented) { .row_size = (size) })
+
+static inline void* dya_segmented_at(const DyaSegmented* s, size_t i);
+// Appends one uninitialized row and returns its address, which never
+// changes.
+static inline void* dya_segmented_add(DyaSegmented* s, size_t row_size);
+// Appends `size` bytes of whole rows from `src`.
+void dya_segmented_append(DyaSegmented* s, size_t size, const void* src);
+// Resizes `out` to a contiguous copy of every row.
+void* dya_segmented_flatten(void* out, const DyaSegmented* s);
+void dya_segmented_free(DyaSegmented* s);
+// Allocates the next segment. Called by dya_segmented_add.
+void dya_segmented_grow(DyaSegmented* s);
+
+#define dya_segmented_push(s, item_type, /*item*/...)                          \
+    (*(item_type*)dya_segmented_add(s, sizeof(item_type)) = (__VA_ARGS__))
+#define dya_segmented_flatten(out, s) (out = (dya_segmented_flatten)(out, s))
+
+// clang-format off
+
+// Iterate over the rows of `arr`, a DyaSegmented pointer, a segment at a
+// time. `iter` is an `item_type` pointer.
+#define dya_segmented_foreach(item_type, iter, arr)                            \
+    for (const DyaSegmented* M_VAR(s) = (arr); M_VAR(s); M_VAR(s) = 0)         \
+    for (size_t M_VAR(k) = 0; !M_VAR(k); M_VAR(k) = SIZE_MAX)                  \
+    for (item_type *iter = 0,                                                  \
+                   *M_VAR(i) = M_VAR(s)->segments[0],                          \
+                   *M_VAR(end) = DYA_SEGMENTED_END(item_type, M_VAR(s), 0);    \
+         (iter = M_VAR(i)) < M_VAR(end);                                       \
+         ++M_VAR(i) < M_VAR(end) ? 0                                           \
+             : (M_VAR(i) = M_VAR(s)->segments[++M_VAR(k)],                     \
+                M_VAR(end) = DYA_SEGMENTED_END(item_type, M_VAR(s), M_VAR(k)), \
+                0))
+
+// End of the rows in use of segment `k`, NULL past the last segment.
+#define DYA_SEGMENTED_END(item_type, s, k)                                     \
+    ((s)->segments[(k) + 1]                                                    \
+            ? (item_type*)(s)->segments[k]                                     \
+                + dya_size((s)->segments[k]) / sizeof(item_type)               \
+            : (item_type*)((s)->segments[k] ? (s)->next : 0))
+
+// clang-format on
+
+// ========= INLINE FUNCTIONS =========
+
+// Segment of row `i`, and the index of its first row in `*first`.
+static inline size_t dya_segmented_segment(size_t i, size_t* first)
+{
+    size_t j = i + DYA_SEGMENTED_FIRST;
+    size_t k = (size_t)(63 - __builtin_clzll(j)) - DYA_SEGMENTED_FIRST_LOG2;
+    *first = (DYA_SEGMENTED_FIRST << k) - DYA_SEGMENTED_FIRST;
+    return k;
+}
+
+static inline void* dya_segmented_at(const DyaSegmented* s, size_t i)
+{
+    assert(i < s->len && "Index out of range!");
+    size_t first;
+    size_t k = dya_segmented_segment(i, &first);
+    return (char*)s->segments[k] + (i - first) * s->row_size;
+}
+
+static inline void* dya_segmented_add(DyaSegmented* s, size_t row_size)
+{
+    assert(row_size == s->row_size && "Row size differs!");
+    if (s->next == s->end)
+        dya_segmented_grow(s);
+    void* row = s->next;
+    s->next += row_size;
+    s->len++;
+    return row;
+}
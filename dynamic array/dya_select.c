@@ -0,0 +1,66 @@
+#pragma once
+#include "dya_select.h"
+#include <string.h> // memcpy
+
+typedef struct {
+    char* base;
+    size_t row_size;
+    DyaCompare* cmp;
+} DyaRows;
+
+static inline int dya_rows_less(DyaRows a, size_t i, DyaRows b, size_t j);
+static inline void dya_rows_swap(DyaRows a, size_t i, size_t j);
+static inline void dya_rows_copy(DyaRows a, size_t i, DyaRows b, size_t j);
+
+DYA_SELECT_ALGORITHMS(dya_rows, DyaRows)
+
+void(dya_nth_element)(void* arr, size_t row_size, size_t nth, DyaCompare* cmp)
+{
+    size_t n = dya_size(arr) / row_size;
+    assert(nth < n && "Index out of range!");
+    dya_rows_nth_element((DyaRows) { arr, row_size, cmp }, 0, n, nth);
+}
+
+void(dya_partial_sort)(void* arr, size_t row_size, size_t k, DyaCompare* cmp)
+{
+    size_t n = dya_size(arr) / row_size;
+    dya_rows_partial_sort((DyaRows) { arr, row_size, cmp }, n, k < n ? k : n);
+}
+
+void*(dya_top_k)(void* out, const void* arr, size_t row_size, size_t k,
+    DyaCompare* cmp)
+{
+    size_t n = dya_size(arr) / row_size;
+    dya_set_size(out, (n < 2 * k ? n : 2 * k) * row_size);
+    k = dya_rows_top_k((DyaRows) { out, row_size, cmp },
+        (DyaRows) { (char*)arr, row_size, cmp }, n, k);
+    dya_set_size(out, k * row_size);
+    return out;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static inline int dya_rows_less(DyaRows a, size_t i, DyaRows b, size_t j)
+{
+    return a.cmp(a.base + i * a.row_size, b.base + j * b.row_size) < 0;
+}
+
+static inline void dya_rows_swap(DyaRows a, size_t i, size_t j)
+{
+    if (i == j)
+        return;
+    char* x = a.base + i * a.row_size;
+    char* y = a.base + j * a.row_size;
+    char tmp[64];
+    for (size_t left = a.row_size, n; left; left -= n, x += n, y += n) {
+        n = left < sizeof tmp ? left : sizeof tmp;
+        memcpy(tmp, x, n);
+        memcpy(x, y, n);
+        memcpy(y, tmp, n);
+    }
+}
+
+static inline void dya_rows_copy(DyaRows a, size_t i, DyaRows b, size_t j)
+{
+    memcpy(a.base + i * a.row_size, b.base + j * b.row_size, a.row_size);
+}
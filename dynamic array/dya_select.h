@@ -0,0 +1,229 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Selection without a full sort.
+ *
+ *   dya_nth_element: reorders `arr` so that arr[nth] is the row a full sort
+ *                    would put there, with no greater rows before it and no
+ *                    smaller rows after it. Introselect, O(n).
+ *   dya_partial_sort: sorts the `k` smallest rows into arr[0, k).
+ *                    The order of the remaining rows is unspecified.
+ *   dya_top_k:       resizes `out` to the `k` greatest rows of `arr`,
+ *                    greatest first. `arr` is not modified. Rows are streamed
+ *                    through a 2k buffer and compared against the current
+ *                    k-th greatest, so small `k` costs about one pass.
+ *
+ * The generic versions take a qsort() comparator. Numeric rows have typed
+ * versions with inlined comparisons, e.g. dya_top_k_f64(out, arr, k), which
+ * return the new `out`. NaNs are unordered, so results are unspecified when
+ * floating point arrays contain them.
+ *
+ * DYA_SELECT_DEFINE(name, type, less) generates the typed versions for any
+ * other type, where `less(a, b)` compares two values:
+ *
+    #define by_deadline(a, b) ((a).deadline < (b).deadline)
+    DYA_SELECT_DEFINE(job, struct job, by_deadline)
+    ...
+    dya_partial_sort_job(jobs, 10);
+ */
+
+typedef int DyaCompare(const void* a, const void* b);
+
+void dya_nth_element(void* arr, size_t row_size, size_t nth, DyaCompare* cmp);
+void dya_partial_sort(void* arr, size_t row_size, size_t k, DyaCompare* cmp);
+void* dya_top_k(void* out, const void* arr, size_t row_size, size_t k,
+    DyaCompare* cmp);
+
+#define dya_nth_element(arr, nth, cmp)                                         \
+    (dya_nth_element)(arr, sizeof *(arr), nth, cmp)
+#define dya_partial_sort(arr, k, cmp)                                          \
+    (dya_partial_sort)(arr, sizeof *(arr), k, cmp)
+#define dya_top_k(out, arr, k, cmp)                                            \
+    (out = (dya_top_k)(out, arr, sizeof *(arr), k, cmp))
+
+/* ========= TYPED VERSIONS ========= */
+
+#define dya_less(a, b) ((a) < (b))
+
+// clang-format off
+
+// Algorithms shared by the generic and typed versions. `Arr` is a handle to
+// the rows, and the functions `P##_less(Arr, i, Arr, j)`, `P##_swap(Arr, i, j)`
+// and `P##_copy(Arr dst, i, Arr src, j)` must already be defined.
+#define DYA_SELECT_ALGORITHMS(P, Arr)                                          \
+    static inline void P##_reverse(Arr a, size_t lo, size_t hi)                \
+    {                                                                          \
+        while (lo + 1 < hi)                                                    \
+            P##_swap(a, lo++, --hi);                                           \
+    }                                                                          \
+    static inline void P##_insertion_sort(Arr a, size_t lo, size_t hi)         \
+    {                                                                          \
+        for (size_t i = lo + 1; i < hi; i++)                                   \
+            for (size_t j = i; j > lo && P##_less(a, j, a, j - 1); j--)        \
+                P##_swap(a, j, j - 1);                                         \
+    }                                                                          \
+    /* Max-heap over a[lo, lo + n). */                                         \
+    static inline void P##_sift_down(Arr a, size_t lo, size_t root, size_t n)  \
+    {                                                                          \
+        for (size_t child; (child = 2 * root + 1) < n; root = child) {         \
+            if (child + 1 < n && P##_less(a, lo + child, a, lo + child + 1))   \
+                child++;                                                       \
+            if (!P##_less(a, lo + root, a, lo + child))                        \
+                return;                                                        \
+            P##_swap(a, lo + root, lo + child);                                \
+        }                                                                      \
+    }                                                                          \
+    /* Sorts the `k` smallest rows of a[lo, hi) into a[lo, lo + k). */         \
+    static inline void P##_heap_select(Arr a, size_t lo, size_t hi, size_t k)  \
+    {                                                                          \
+        for (size_t i = k / 2; i-- > 0;)                                       \
+            P##_sift_down(a, lo, i, k);                                        \
+        for (size_t i = lo + k; i < hi; i++) {                                 \
+            if (P##_less(a, i, a, lo)) {                                       \
+                P##_swap(a, i, lo);                                            \
+                P##_sift_down(a, lo, 0, k);                                    \
+            }                                                                  \
+        }                                                                      \
+        for (size_t n = k; n > 1; n--) {                                       \
+            P##_swap(a, lo, lo + n - 1);                                       \
+            P##_sift_down(a, lo, 0, n - 1);                                    \
+        }                                                                      \
+    }                                                                          \
+    /* Hoare partition around a median of three. Needs hi - lo >= 3. */       \
+    static inline size_t P##_partition(Arr a, size_t lo, size_t hi)            \
+    {                                                                          \
+        size_t mid = lo + (hi - lo) / 2, i = lo, j = hi;                       \
+        if (P##_less(a, mid, a, lo))                                           \
+            P##_swap(a, mid, lo);                                              \
+        if (P##_less(a, hi - 1, a, mid)) {                                     \
+            P##_swap(a, hi - 1, mid);                                          \
+            if (P##_less(a, mid, a, lo))                                       \
+                P##_swap(a, mid, lo);                                          \
+        }                                                                      \
+        P##_swap(a, lo, mid);                                                  \
+        for (;;) {                                                             \
+            do i++; while (P##_less(a, i, a, lo));                             \
+            do j--; while (P##_less(a, lo, a, j));                             \
+            if (i >= j)                                                        \
+                break;                                                         \
+            P##_swap(a, i, j);                                                 \
+        }                                                                      \
+        P##_swap(a, lo, j);                                                    \
+        return j;                                                              \
+    }                                                                          \
+    static inline void P##_nth_element(Arr a, size_t lo, size_t hi,           \
+        size_t nth)                                                            \
+    {                                                                          \
+        size_t depth = 0;                                                      \
+        for (size_t n = hi - lo; n > 1; n >>= 1)                               \
+            depth += 2;                                                        \
+        while (hi - lo > 16) {                                                 \
+            if (!depth--) {                                                    \
+                P##_heap_select(a, lo, hi, nth - lo + 1);                      \
+                return;                                                        \
+            }                                                                  \
+            size_t p = P##_partition(a, lo, hi);                               \
+            if (p == nth)                                                      \
+                return;                                                        \
+            if (nth < p)                                                       \
+                hi = p;                                                        \
+            else                                                               \
+                lo = p + 1;                                                    \
+        }                                                                      \
+        P##_insertion_sort(a, lo, hi);                                         \
+    }                                                                          \
+    static inline void P##_partial_sort(Arr a, size_t n, size_t k)             \
+    {                                                                          \
+        if (k > n / 64) {                                                      \
+            if (k < n)                                                         \
+                P##_nth_element(a, 0, n, k - 1);                               \
+            n = k;                                                             \
+        }                                                                      \
+        P##_heap_select(a, 0, n, k);                                           \
+    }                                                                          \
+    /* Moves the `k` greatest of a[0, m) to a[0, k), smallest of them first. */\
+    static inline void P##_keep_greatest(Arr a, size_t m, size_t k)            \
+    {                                                                          \
+        P##_nth_element(a, 0, m, m - k);                                       \
+        P##_reverse(a, 0, m);                                                  \
+        P##_reverse(a, 0, k);                                                  \
+    }                                                                          \
+    /* `out` must have room for min(n, 2 * k) rows. Returns the row count. */  \
+    static inline size_t P##_top_k(Arr out, Arr src, size_t n, size_t k)       \
+    {                                                                          \
+        if (!k)                                                                \
+            return 0;                                                          \
+        size_t m = 0;                                                          \
+        int full = 0;                                                          \
+        for (size_t i = 0; i < n; i++) {                                       \
+            /* Skip blocks with nothing above out[0], the k-th greatest. */    \
+            if (full && i % 16 == 0 && i + 16 <= n) {                          \
+                int any = 0;                                                   \
+                for (size_t j = i; j < i + 16; j++)                            \
+                    any |= P##_less(out, 0, src, j);                           \
+                if (!any) {                                                    \
+                    i += 15;                                                   \
+                    continue;                                                  \
+                }                                                              \
+            }                                                                  \
+            if (full && !P##_less(out, 0, src, i))                             \
+                continue;                                                      \
+            P##_copy(out, m++, src, i);                                        \
+            if (m == 2 * k) {                                                  \
+                P##_keep_greatest(out, m, k);                                  \
+                m = k;                                                         \
+                full = 1;                                                      \
+            }                                                                  \
+        }                                                                      \
+        if (m > k)                                                             \
+            P##_keep_greatest(out, m, k);                                      \
+        m = m < k ? m : k;                                                     \
+        P##_heap_select(out, 0, m, m);                                         \
+        P##_reverse(out, 0, m);                                                \
+        return m;                                                              \
+    }
+
+#define DYA_SELECT_DEFINE(name, T, less)                                       \
+    static inline int dya_sel_##name##_less(T* a, size_t i, T* b, size_t j)    \
+    {                                                                          \
+        return less(a[i], b[j]);                                               \
+    }                                                                          \
+    static inline void dya_sel_##name##_swap(T* a, size_t i, size_t j)        \
+    {                                                                          \
+        T tmp = a[i];                                                          \
+        a[i] = a[j];                                                           \
+        a[j] = tmp;                                                            \
+    }                                                                          \
+    static inline void dya_sel_##name##_copy(T* a, size_t i, T* b, size_t j)   \
+    {                                                                          \
+        a[i] = b[j];                                                           \
+    }                                                                          \
+    DYA_SELECT_ALGORITHMS(dya_sel_##name, T*)                                  \
+    static inline void dya_nth_element_##name(T* arr, size_t nth)             \
+    {                                                                          \
+        assert(nth < dya_len(arr) && "Index out of range!");                  \
+        dya_sel_##name##_nth_element(arr, 0, dya_len(arr), nth);               \
+    }                                                                          \
+    static inline void dya_partial_sort_##name(T* arr, size_t k)              \
+    {                                                                          \
+        size_t n = dya_len(arr);                                               \
+        dya_sel_##name##_partial_sort(arr, n, k < n ? k : n);                  \
+    }                                                                          \
+    static inline T* dya_top_k_##name(T* out, const T* arr, size_t k)         \
+    {                                                                          \
+        size_t n = dya_len(arr);                                               \
+        dya_set_len(out, n < 2 * k ? n : 2 * k);                               \
+        k = dya_sel_##name##_top_k(out, (T*)arr, n, k);                        \
+        dya_set_len(out, k);                                                   \
+        return out;                                                            \
+    }
+
+// clang-format on
+
+DYA_SELECT_DEFINE(i32, int32_t, dya_less)
+DYA_SELECT_DEFINE(u32, uint32_t, dya_less)
+DYA_SELECT_DEFINE(i64, int64_t, dya_less)
+DYA_SELECT_DEFINE(u64, uint64_t, dya_less)
+DYA_SELECT_DEFINE(f32, float, dya_less)
+DYA_SELECT_DEFINE(f64, double, dya_less)
@@ -0,0 +1,71 @@
+#pragma once
+#include "dya_sparse.h"
+
+DyaSparse dya_sparse(size_t row_size)
+{
+    assert(row_size && "Row size is 0!");
+    DyaSparse s = { .row_size = row_size };
+    s.zero_page = dya_alloc(DYA_SPARSE_PAGE_ROWS, row_size);
+    dya_set_len(s.zero_table, DYA_SPARSE_TABLE_PAGES);
+    for (size_t p = 0; p < DYA_SPARSE_TABLE_PAGES; p++)
+        s.zero_table[p] = s.zero_page;
+    dya_set_len(s.dir, DYA_SPARSE_DIR_TABLES);
+    for (size_t t = 0; t < DYA_SPARSE_DIR_TABLES; t++)
+        s.dir[t] = s.zero_table;
+    return s;
+}
+
+void dya_sparse_free(DyaSparse* s)
+{
+    for (size_t t = 0; t < dya_len(s->dir); t++) {
+        if (s->dir[t] == s->zero_table)
+            continue;
+        for (size_t p = 0; p < DYA_SPARSE_TABLE_PAGES; p++) {
+            if (s->dir[t][p] != s->zero_page)
+                dya_free(s->dir[t][p]);
+        }
+        dya_free(s->dir[t]);
+    }
+    dya_free(s->dir);
+    dya_free(s->zero_table);
+    dya_free(s->zero_page);
+    s->pages = 0;
+}
+
+char* dya_sparse_add_page(DyaSparse* s, uint32_t id)
+{
+    char*** table = &s->dir[id >> (DYA_SPARSE_PAGE_BITS
+        + DYA_SPARSE_TABLE_BITS)];
+    if (*table == s->zero_table) {
+        *table = 0;
+        dya_append(*table, dya_size(s->zero_table), s->zero_table);
+    }
+    char** page = &(*table)[id >> DYA_SPARSE_PAGE_BITS
+        & (DYA_SPARSE_TABLE_PAGES - 1)];
+    if (*page == s->zero_page) {
+        *page = dya_alloc(DYA_SPARSE_PAGE_ROWS, s->row_size);
+        s->pages++;
+    }
+    return *page;
+}
+
+void* dya_sparse_next_page(const DyaSparse* s, size_t* cursor, size_t* id)
+{
+    size_t n_pages = DYA_SPARSE_DIR_TABLES * DYA_SPARSE_TABLE_PAGES;
+    for (size_t p = *cursor; p < n_pages; p++) {
+        char** table = s->dir[p / DYA_SPARSE_TABLE_PAGES];
+        if (table == s->zero_table) {
+            // Skip the rest of an absent table at once.
+            p |= DYA_SPARSE_TABLE_PAGES - 1;
+            continue;
+        }
+        char* page = table[p % DYA_SPARSE_TABLE_PAGES];
+        if (page != s->zero_page) {
+            *cursor = p + 1;
+            *id = p * DYA_SPARSE_PAGE_ROWS;
+            return page;
+        }
+    }
+    *cursor = n_pages;
+    return 0;
+}
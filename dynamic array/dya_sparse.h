@@ -0,0 +1,105 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Sparse arrays indexed by 32-bit ids, with pages allocated on first write.
+ *
+ * A dya_alloc'd array indexed by sparse ids costs memory (and a memset) for
+ * every id up to the largest one. DyaSparse splits the id space into pages
+ * of `DYA_SPARSE_PAGE_ROWS` rows found through a two-level table, and only
+ * allocates a page (zeroed) when one of its rows is written, so memory grows
+ * with the populated ids instead.
+ *
+ * Absent pages and tables point to one shared zero page and zero table, so a
+ * read is two dependent loads with no branch and returns zeros for ids that
+ * were never written. Writes must go through dya_sparse_put (or
+ * dya_sparse_set), which allocates the page first; never write through
+ * dya_sparse_at. dya_sparse_foreach visits every row of the allocated pages
+ * in id order and skips the rest.
+ *
+ * Usage example:
+    DyaSparse scores = dya_sparse(sizeof(float));
+    dya_sparse_set(&scores, float, user_id, 0.5f);
+    *(float*)dya_sparse_put(&scores, other_id) += 1;
+    float s = dya_sparse_get(&scores, float, 123456789); // 0 if never set
+
+    dya_sparse_foreach(float, score, id, &scores)
+    {
+        if (*score)
+            printf("%zu %f\n", id, *score);
+    }
+    dya_sparse_free(&scores);
+ */
+
+// log2 of the rows per page and of the pages per table. The directory
+// covers the remaining high bits of the id.
+#ifndef DYA_SPARSE_PAGE_BITS
+#define DYA_SPARSE_PAGE_BITS 12
+#endif
+#ifndef DYA_SPARSE_TABLE_BITS
+#define DYA_SPARSE_TABLE_BITS 10
+#endif
+#define DYA_SPARSE_PAGE_ROWS ((size_t)1 << DYA_SPARSE_PAGE_BITS)
+#define DYA_SPARSE_TABLE_PAGES ((size_t)1 << DYA_SPARSE_TABLE_BITS)
+#define DYA_SPARSE_DIR_TABLES                                                  \
+    ((size_t)1 << (32 - DYA_SPARSE_PAGE_BITS - DYA_SPARSE_TABLE_BITS))
+
+typedef struct {
+    char*** dir; // dyarray of tables, each a dyarray of pages
+    char** zero_table; // shared by every absent table
+    char* zero_page; // shared by every absent page, never written
+    size_t row_size;
+    size_t pages; // allocated, not counting the zero page
+} DyaSparse;
+
+DyaSparse dya_sparse(size_t row_size);
+void dya_sparse_free(DyaSparse* s);
+// Allocates the page of `id`. Called by dya_sparse_put.
+char* dya_sparse_add_page(DyaSparse* s, uint32_t id);
+// First allocated page at or after page `*cursor`, which is moved past it,
+// and the id of its first row in `*id`. NULL when there are no more.
+void* dya_sparse_next_page(const DyaSparse* s, size_t* cursor, size_t* id);
+
+// Row `id` for reading, all zeros if it was never written.
+static inline const void* dya_sparse_at(const DyaSparse* s, uint32_t id)
+{
+    const char* page = s->dir[id >> (DYA_SPARSE_PAGE_BITS
+        + DYA_SPARSE_TABLE_BITS)][id >> DYA_SPARSE_PAGE_BITS
+        & (DYA_SPARSE_TABLE_PAGES - 1)];
+    return page + (id & (DYA_SPARSE_PAGE_ROWS - 1)) * s->row_size;
+}
+
+// Row `id` for writing.
+static inline void* dya_sparse_put(DyaSparse* s, uint32_t id)
+{
+    char* page = s->dir[id >> (DYA_SPARSE_PAGE_BITS + DYA_SPARSE_TABLE_BITS)]
+                       [id >> DYA_SPARSE_PAGE_BITS
+                           & (DYA_SPARSE_TABLE_PAGES - 1)];
+    if (page == s->zero_page)
+        page = dya_sparse_add_page(s, id);
+    return page + (id & (DYA_SPARSE_PAGE_ROWS - 1)) * s->row_size;
+}
+
+#define dya_sparse_get(s, item_type, id)                                       \
+    (*(const item_type*)dya_sparse_at(s, id))
+#define dya_sparse_set(s, item_type, id, /*item*/...)                          \
+    (*(item_type*)dya_sparse_put(s, id) = (__VA_ARGS__))
+
+// clang-format off
+
+// Iterate over the rows of the allocated pages of `arr`, a DyaSparse pointer.
+// `iter` is an `item_type` pointer and `id` a size_t holding its id.
+#define dya_sparse_foreach(item_type, iter, id, arr)                           \
+    for (const DyaSparse* M_VAR(s) = (arr); M_VAR(s); M_VAR(s) = 0)            \
+    for (size_t M_VAR(k) = 0, id = 0; !M_VAR(k); M_VAR(k) = SIZE_MAX)          \
+    for (item_type *iter = 0,                                                  \
+                   *M_VAR(i) = dya_sparse_next_page(M_VAR(s), &M_VAR(k), &id), \
+                   *M_VAR(end) = M_VAR(i) ? M_VAR(i) + DYA_SPARSE_PAGE_ROWS    \
+                                          : 0;                                 \
+         (iter = M_VAR(i)) < M_VAR(end);                                       \
+         ++id, ++M_VAR(i) < M_VAR(end) ? 0                                     \
+             : (M_VAR(i) = dya_sparse_next_page(M_VAR(s), &M_VAR(k), &id),     \
+                M_VAR(end) = M_VAR(i) ? M_VAR(i) + DYA_SPARSE_PAGE_ROWS : 0,   \
+                0))
+
+// clang-format on
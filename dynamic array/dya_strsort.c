@@ -0,0 +1,203 @@
+#pragma once
+#include "dya_strsort.h"
+#include "dya_gather.h"
+#include <string.h> // memcpy, memset
+
+// Buckets smaller than this are sorted with multikey quicksort.
+#define DYA_STRSORT_RADIX_MIN 64
+// Ranges smaller than this are insertion sorted.
+#define DYA_STRSORT_INSERTION_MAX 16
+
+typedef struct {
+    uint64_t key; // Big-endian bytes [depth, depth + 8) of the string.
+    uint32_t idx;
+} DyaStrEntry;
+
+// Rows that share their first `depth` bytes, still to be sorted.
+typedef struct {
+    DyaStrEntry* e;
+    size_t n;
+    size_t depth;
+} DyaStrRange;
+
+typedef struct {
+    const DyaStr* strs;
+    DyaStrEntry* tmp;
+    // Ties are queued here instead of recursing, so that the stack depth
+    // does not grow with the length of shared prefixes.
+    DyaStrRange* todo;
+} DyaStrSort;
+
+static inline uint64_t dya_str_prefix(DyaStr s, size_t depth);
+static void dya_strsort(DyaStrSort* s, DyaStrEntry* e, size_t n, size_t depth);
+static void dya_strsort_radix(DyaStrSort* s, DyaStrEntry* e, size_t n,
+    size_t depth, unsigned byte);
+static void dya_strsort_mkqs(DyaStrSort* s, DyaStrEntry* e, size_t n,
+    size_t depth);
+static void dya_strsort_ties(DyaStrSort* s, DyaStrEntry* e, size_t n,
+    size_t depth);
+
+void dya_sort_strings(DyaStr* strs)
+{
+    uint32_t* perm = 0;
+    DyaStr* sorted = 0;
+    dya_sort_strings_index(perm, strs);
+    dya_gather(sorted, strs, perm);
+    if (sorted)
+        memcpy(strs, sorted, dya_size(sorted));
+    dya_free(sorted);
+    dya_free(perm);
+}
+
+uint32_t*(dya_sort_strings_index)(uint32_t* perm, const DyaStr* strs)
+{
+    size_t n = dya_len(strs);
+    assert(n <= UINT32_MAX && "Too many strings!");
+    dya_set_len(perm, n);
+    if (!n)
+        return perm;
+
+    DyaStrEntry* entries = 0;
+    DyaStrSort s = { strs, 0, 0 };
+    dya_set_len(entries, n);
+    dya_set_len(s.tmp, n);
+    for (size_t i = 0; i < n; i++)
+        entries[i].idx = (uint32_t)i;
+
+    dya_push(s.todo, (DyaStrRange) { entries, n, 0 });
+    while (dya_len(s.todo)) {
+        DyaStrRange r = dya_pop(s.todo);
+        dya_strsort(&s, r.e, r.n, r.depth);
+    }
+
+    for (size_t i = 0; i < n; i++)
+        perm[i] = entries[i].idx;
+    dya_free(s.todo);
+    dya_free(s.tmp);
+    dya_free(entries);
+    return perm;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static inline uint64_t dya_str_prefix(DyaStr s, size_t depth)
+{
+    uint64_t key = 0;
+    if (s.len > depth) {
+        size_t left = s.len - depth;
+        memcpy(&key, s.ptr + depth, left < 8 ? left : 8);
+    }
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    key = __builtin_bswap64(key);
+#endif
+    return key;
+}
+
+static inline void dya_str_swap(DyaStrEntry* a, DyaStrEntry* b)
+{
+    DyaStrEntry tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+// Sorts rows that share their first `depth` bytes.
+static void dya_strsort(DyaStrSort* s, DyaStrEntry* e, size_t n, size_t depth)
+{
+    for (size_t i = 0; i < n; i++)
+        e[i].key = dya_str_prefix(s->strs[e[i].idx], depth);
+    if (n < DYA_STRSORT_RADIX_MIN)
+        dya_strsort_mkqs(s, e, n, depth);
+    else
+        dya_strsort_radix(s, e, n, depth, 0);
+}
+
+// Splits on byte `byte` of the cached key. Keys already agree on the bytes
+// before it.
+static void dya_strsort_radix(DyaStrSort* s, DyaStrEntry* e, size_t n,
+    size_t depth, unsigned byte)
+{
+    uint32_t count[256];
+    unsigned shift;
+    for (;; byte++) {
+        if (byte == 8) {
+            dya_strsort_ties(s, e, n, depth);
+            return;
+        }
+        shift = 56 - 8 * byte;
+        memset(count, 0, sizeof count);
+        for (size_t i = 0; i < n; i++)
+            count[(e[i].key >> shift) & 255]++;
+        // All rows share this byte, so there is nothing to move.
+        if (count[(e[0].key >> shift) & 255] != n)
+            break;
+    }
+
+    uint32_t offsets[256];
+    for (size_t b = 0, sum = 0; b < 256; sum += count[b++])
+        offsets[b] = (uint32_t)sum;
+    for (size_t i = 0; i < n; i++)
+        s->tmp[offsets[(e[i].key >> shift) & 255]++] = e[i];
+    memcpy(e, s->tmp, n * sizeof *e);
+
+    for (size_t b = 0, start = 0; b < 256; start += count[b++]) {
+        if (count[b] < 2)
+            continue;
+        if (count[b] < DYA_STRSORT_RADIX_MIN)
+            dya_strsort_mkqs(s, e + start, count[b], depth);
+        else
+            dya_strsort_radix(s, e + start, count[b], depth, byte + 1);
+    }
+}
+
+// Three-way quicksort on the whole cached key.
+static void dya_strsort_mkqs(DyaStrSort* s, DyaStrEntry* e, size_t n,
+    size_t depth)
+{
+    while (n > DYA_STRSORT_INSERTION_MAX) {
+        uint64_t a = e[0].key, b = e[n / 2].key, c = e[n - 1].key;
+        uint64_t pivot = a < b ? (b < c ? b : a < c ? c : a)
+                               : (a < c ? a : b < c ? c : b);
+        size_t lt = 0, i = 0, gt = n;
+        while (i < gt) {
+            if (e[i].key < pivot)
+                dya_str_swap(&e[lt++], &e[i++]);
+            else if (e[i].key > pivot)
+                dya_str_swap(&e[i], &e[--gt]);
+            else
+                i++;
+        }
+        dya_strsort_mkqs(s, e, lt, depth);
+        dya_strsort_ties(s, e + lt, gt - lt, depth);
+        e += gt;
+        n -= gt;
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        DyaStrEntry x = e[i];
+        size_t j = i;
+        for (; j && e[j - 1].key > x.key; j--)
+            e[j] = e[j - 1];
+        e[j] = x;
+    }
+    for (size_t i = 0, j; i < n; i = j) {
+        for (j = i + 1; j < n && e[j].key == e[i].key;)
+            j++;
+        dya_strsort_ties(s, e + i, j - i, depth);
+    }
+}
+
+// Orders rows whose keys at `depth` are all equal. Rows that end within the
+// key come first, shortest first; the rest are queued for `depth + 8`.
+static void dya_strsort_ties(DyaStrSort* s, DyaStrEntry* e, size_t n,
+    size_t depth)
+{
+    if (n < 2)
+        return;
+    size_t done = 0;
+    for (size_t left = 0; left <= 8; left++)
+        for (size_t i = done; i < n; i++)
+            if (s->strs[e[i].idx].len == depth + left)
+                dya_str_swap(&e[done++], &e[i]);
+    if (n - done > 1)
+        dya_push(s->todo, (DyaStrRange) { e + done, n - done, depth + 8 });
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Sorting dyarrays of strings and byte slices.
+ *
+ * Strings are (pointer, length) views ordered like memcmp() on unsigned
+ * bytes, with a string sorting before any longer string it is a prefix of.
+ * Embedded zero bytes are fine.
+ *
+ * The sort works on 8-byte big-endian key prefixes cached next to each row
+ * index, so most comparisons are a single integer compare that never touches
+ * the string data. Large buckets are split with MSD radix sort, one byte of
+ * the prefix at a time; small ones with multikey quicksort on the whole
+ * prefix. Rows whose prefixes tie are sorted again on their next 8 bytes.
+ *
+ * dya_sort_strings_index leaves `strs` alone and produces the permutation
+ * instead, so that strs[perm[0]], strs[perm[1]], ... is sorted. At most
+ * UINT32_MAX strings are supported.
+ *
+ * Usage example:
+    DyaStr* words = 0;
+    dya_push(words, ((DyaStr) { "banana", 6 }));
+    dya_push(words, ((DyaStr) { "apple", 5 }));
+    dya_sort_strings(words);
+
+    uint32_t* order = 0;
+    dya_sort_strings_index(order, words);
+ */
+
+typedef struct {
+    const char* ptr;
+    size_t len;
+} DyaStr;
+
+void dya_sort_strings(DyaStr* strs);
+uint32_t* dya_sort_strings_index(uint32_t* perm, const DyaStr* strs);
+
+#define dya_sort_strings_index(perm, strs)                                     \
+    (perm = (dya_sort_strings_index)(perm, strs))
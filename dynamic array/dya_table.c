@@ -0,0 +1,474 @@
+#pragma once
+#include "dya_table.h"
+#include "dya_hash.h"
+#include <math.h> // INFINITY
+#include <stdatomic.h>
+#include <stdlib.h> // qsort
+#include <string.h> // memmove, strcmp
+
+// Rows whose group ids are looked up before the aggregates are updated.
+#define DYA_GROUP_BATCH 1024
+
+typedef union {
+    int64_t i;
+    double f;
+} DyaAccum;
+
+typedef struct {
+    int64_t* keys; // one per group
+    uint32_t* slots; // power of two, group + 1 or 0 when empty
+    DyaAccum* acc; // n_aggs per group
+} DyaGroups;
+
+typedef struct {
+    const DyaColumn* col;
+    const uint32_t* sel;
+    size_t n; // rows in `sel`, or in the column when `sel` is NULL
+    DyaPred pred;
+    int64_t* iset; // sorted copies of `pred.set`
+    double* fset;
+    uint32_t* out; // morsel `m` writes from out[m * DYA_MORSEL_ROWS]
+    size_t* counts; // one per morsel
+    size_t n_morsels;
+    atomic_size_t next;
+} DyaFilterJob;
+
+typedef struct {
+    const DyaColumn* key;
+    const uint32_t* sel;
+    size_t n;
+    const DyaAgg* aggs;
+    size_t n_aggs;
+    DyaGroups* groups; // one per task
+    size_t n_morsels;
+    atomic_size_t next;
+} DyaGroupJob;
+
+static inline size_t dya_type_size(DyaType type);
+static inline size_t dya_morsel_end(size_t m, size_t n);
+static void dya_filter_task(void* job, size_t i);
+static void dya_group_task(void* job, size_t i);
+static size_t dya_groups_find(DyaGroups* g, int64_t key, const DyaAgg* aggs,
+    size_t n_aggs);
+static void dya_groups_free(DyaGroups* g);
+static DyaTable dya_groups_to_table(DyaGroups* g, const DyaAgg* aggs,
+    size_t n_aggs);
+
+void dya_table_add_column(DyaTable* t, const char* name, DyaType type,
+    void* data)
+{
+    size_t rows = dya_size(data) / dya_type_size(type);
+    assert((!t->columns || rows == t->rows) && "Column lengths differ!");
+    assert(rows <= UINT32_MAX && "Too many rows!");
+    t->rows = rows;
+    dya_push(t->columns, ((DyaColumn) { name, type, data }));
+}
+
+DyaColumn* dya_table_column(const DyaTable* t, const char* name)
+{
+    dya_foreach(DyaColumn, col, t->columns)
+    {
+        if (!strcmp(col->name, name))
+            return col;
+    }
+    return 0;
+}
+
+void dya_table_free(DyaTable* t)
+{
+    dya_foreach(DyaColumn, col, t->columns) dya_free(col->data);
+    dya_free(t->columns);
+    t->rows = 0;
+}
+
+uint32_t*(dya_filter)(uint32_t* sel, const DyaColumn* col, DyaPred pred)
+{
+    return (dya_filter_parallel)(sel, col, pred, 1, 0);
+}
+
+static int dya_cmp_i64(const void* a, const void* b);
+static int dya_cmp_f64(const void* a, const void* b);
+
+uint32_t*(dya_filter_parallel)(uint32_t* sel, const DyaColumn* col,
+    DyaPred pred, size_t n_tasks, DyaParallelFor* pfor)
+{
+    size_t rows = dya_size(col->data) / dya_type_size(col->type);
+    size_t n = sel ? dya_len(sel) : rows;
+    DyaFilterJob job = { col, sel, n, pred, 0, 0, sel, 0, 0, 0 };
+    if (pred.op == DYA_IN) {
+        dya_foreach(const DyaValue, v, pred.set)
+        {
+            dya_push(job.iset, v->i);
+            dya_push(job.fset, v->f);
+        }
+        if (job.iset) {
+            qsort(job.iset, dya_len(job.iset), sizeof *job.iset, dya_cmp_i64);
+            qsort(job.fset, dya_len(job.fset), sizeof *job.fset, dya_cmp_f64);
+        }
+    }
+    // Filters compact `sel` in place. Without one, every row is a candidate.
+    if (!sel)
+        dya_set_len(job.out, n);
+    job.n_morsels = (n + DYA_MORSEL_ROWS - 1) / DYA_MORSEL_ROWS;
+    job.counts = dya_alloc(job.n_morsels, sizeof *job.counts);
+    atomic_init(&job.next, 0);
+
+    dya_parallel_for(pfor, n_tasks ? n_tasks : 1, dya_filter_task, &job);
+
+    size_t kept = 0;
+    for (size_t m = 0; m < job.n_morsels; m++) {
+        memmove(job.out + kept, job.out + m * DYA_MORSEL_ROWS,
+            job.counts[m] * sizeof *job.out);
+        kept += job.counts[m];
+    }
+    dya_set_len(job.out, kept);
+    if (!job.out)
+        dya_reserve(job.out, sizeof *job.out);
+
+    dya_free(job.counts);
+    dya_free(job.fset);
+    dya_free(job.iset);
+    return job.out;
+}
+
+DyaTable dya_group_by(const DyaColumn* key, const uint32_t* sel,
+    const DyaAgg* aggs, size_t n_aggs)
+{
+    return dya_group_by_parallel(key, sel, aggs, n_aggs, 1, 0);
+}
+
+DyaTable dya_group_by_parallel(const DyaColumn* key, const uint32_t* sel,
+    const DyaAgg* aggs, size_t n_aggs, size_t n_tasks, DyaParallelFor* pfor)
+{
+    assert(key->type != DYA_F64 && "Group keys must be integers!");
+    if (!n_tasks)
+        n_tasks = 1;
+    size_t rows = dya_size(key->data) / dya_type_size(key->type);
+    size_t n = sel ? dya_len(sel) : rows;
+    DyaGroupJob job = { key, sel, n, aggs, n_aggs, 0, 0, 0 };
+    job.groups = dya_alloc(n_tasks, sizeof *job.groups);
+    job.n_morsels = (n + DYA_MORSEL_ROWS - 1) / DYA_MORSEL_ROWS;
+    atomic_init(&job.next, 0);
+
+    dya_parallel_for(pfor, n_tasks, dya_group_task, &job);
+
+    // Fold every task's groups into the first one.
+    DyaGroups* all = &job.groups[0];
+    for (size_t t = 1; t < n_tasks; t++) {
+        DyaGroups* g = &job.groups[t];
+        for (size_t i = 0; i < dya_len(g->keys); i++) {
+            size_t into = dya_groups_find(all, g->keys[i], aggs, n_aggs);
+            DyaAccum* dst = &all->acc[into * n_aggs];
+            DyaAccum* src = &g->acc[i * n_aggs];
+            for (size_t a = 0; a < n_aggs; a++) {
+                int f = aggs[a].op != DYA_COUNT && aggs[a].col->type == DYA_F64;
+                switch (aggs[a].op) {
+                case DYA_COUNT:
+                case DYA_SUM:
+                    if (f)
+                        dst[a].f += src[a].f;
+                    else
+                        dst[a].i += src[a].i;
+                    break;
+                case DYA_MIN:
+                    if (f)
+                        dst[a].f = src[a].f < dst[a].f ? src[a].f : dst[a].f;
+                    else if (src[a].i < dst[a].i)
+                        dst[a].i = src[a].i;
+                    break;
+                case DYA_MAX:
+                    if (f)
+                        dst[a].f = src[a].f > dst[a].f ? src[a].f : dst[a].f;
+                    else if (src[a].i > dst[a].i)
+                        dst[a].i = src[a].i;
+                    break;
+                }
+            }
+        }
+        dya_groups_free(g);
+    }
+
+    DyaTable result = dya_groups_to_table(all, aggs, n_aggs);
+    dya_groups_free(all);
+    dya_free(job.groups);
+    return result;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static inline size_t dya_type_size(DyaType type)
+{
+#define DYA_TYPE_SIZE(e, T, W)                                                 \
+    case e: return sizeof(T);
+    switch (type) { DYA_COLUMN_TYPES(DYA_TYPE_SIZE) }
+#undef DYA_TYPE_SIZE
+    assert(0 && "Unknown column type!");
+    return 0;
+}
+
+static inline size_t dya_morsel_end(size_t m, size_t n)
+{
+    size_t end = (m + 1) * DYA_MORSEL_ROWS;
+    return end < n ? end : n;
+}
+
+static int dya_cmp_i64(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int dya_cmp_f64(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Small sets are scanned without branches, larger ones binary searched.
+#define DYA_SET_CONTAINS(W)                                                    \
+    static inline int dya_set_contains_##W(const W* set, size_t n, W x)        \
+    {                                                                          \
+        if (n <= 8) {                                                          \
+            int found = 0;                                                     \
+            for (size_t i = 0; i < n; i++)                                     \
+                found |= set[i] == x;                                          \
+            return found;                                                      \
+        }                                                                      \
+        size_t lo = 0;                                                         \
+        while (n > 1) {                                                        \
+            size_t half = n / 2;                                               \
+            lo = set[lo + half] <= x ? lo + half : lo;                         \
+            n -= half;                                                         \
+        }                                                                      \
+        return set[lo] == x;                                                   \
+    }
+DYA_SET_CONTAINS(int64_t)
+DYA_SET_CONTAINS(double)
+
+// Branch-free: every candidate is written, and the cursor only advances
+// past the ones that match.
+#define DYA_FILTER_LOOP(W, cond)                                               \
+    do {                                                                       \
+        if (sel) {                                                             \
+            for (size_t j = begin; j < end; j++) {                             \
+                uint32_t r = sel[j];                                           \
+                W x = data[r];                                                 \
+                out[k] = r;                                                    \
+                k += (cond);                                                   \
+            }                                                                  \
+        } else {                                                               \
+            for (size_t r = begin; r < end; r++) {                             \
+                W x = data[r];                                                 \
+                out[k] = (uint32_t)r;                                          \
+                k += (cond);                                                   \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+#define DYA_FILTER_RANGE(e, T, W)                                              \
+    static size_t dya_filter_range_##e(const DyaFilterJob* job, uint32_t* out, \
+        size_t begin, size_t end)                                              \
+    {                                                                          \
+        const T* data = job->col->data;                                        \
+        const uint32_t* sel = job->sel;                                        \
+        const W* set = _Generic((W)0, double: job->fset, default: job->iset);  \
+        size_t n_set = dya_len(job->iset);                                     \
+        W a = _Generic((W)0, double: job->pred.a.f, default: job->pred.a.i);   \
+        W b = _Generic((W)0, double: job->pred.b.f, default: job->pred.b.i);   \
+        size_t k = 0;                                                          \
+        switch (job->pred.op) {                                                \
+        case DYA_EQ: DYA_FILTER_LOOP(W, x == a); break;                        \
+        case DYA_NE: DYA_FILTER_LOOP(W, x != a); break;                        \
+        case DYA_LT: DYA_FILTER_LOOP(W, x < a); break;                         \
+        case DYA_LE: DYA_FILTER_LOOP(W, x <= a); break;                        \
+        case DYA_GT: DYA_FILTER_LOOP(W, x > a); break;                         \
+        case DYA_GE: DYA_FILTER_LOOP(W, x >= a); break;                        \
+        case DYA_BETWEEN: DYA_FILTER_LOOP(W, (a <= x) & (x <= b)); break;      \
+        case DYA_IN:                                                           \
+            DYA_FILTER_LOOP(W, _Generic((W)0,                                  \
+                double: dya_set_contains_double,                               \
+                default: dya_set_contains_int64_t)(set, n_set, x));            \
+            break;                                                             \
+        }                                                                      \
+        return k;                                                              \
+    }
+DYA_COLUMN_TYPES(DYA_FILTER_RANGE)
+
+static void dya_filter_task(void* job, size_t i)
+{
+    (void)i;
+    DyaFilterJob* j = job;
+    for (size_t m; (m = atomic_fetch_add(&j->next, 1)) < j->n_morsels;) {
+        size_t begin = m * DYA_MORSEL_ROWS, end = dya_morsel_end(m, j->n);
+        uint32_t* out = j->out + begin;
+#define DYA_FILTER_CASE(e, T, W)                                               \
+    case e: j->counts[m] = dya_filter_range_##e(j, out, begin, end); break;
+        switch (j->col->type) { DYA_COLUMN_TYPES(DYA_FILTER_CASE) }
+#undef DYA_FILTER_CASE
+    }
+}
+
+// Reads the rows `rows[0, n)` of `col` as `W`.
+#define DYA_LOAD_AS(W)                                                         \
+    static void dya_load_##W(W* dst, const DyaColumn* col,                     \
+        const uint32_t* rows, size_t n)                                        \
+    {                                                                          \
+        switch (col->type) {                                                   \
+            DYA_COLUMN_TYPES(DYA_LOAD_CASE)                                    \
+        }                                                                      \
+    }
+#define DYA_LOAD_CASE(e, T, W)                                                 \
+    case e:                                                                    \
+        for (size_t i = 0; i < n; i++)                                         \
+            dst[i] = ((const T*)col->data)[rows[i]];                           \
+        break;
+DYA_LOAD_AS(int64_t)
+DYA_LOAD_AS(double)
+#undef DYA_LOAD_CASE
+
+static inline DyaAccum dya_accum_init(DyaAgg agg)
+{
+    int f = agg.op != DYA_COUNT && agg.col->type == DYA_F64;
+    switch (agg.op) {
+    case DYA_MIN: return f ? (DyaAccum) { .f = INFINITY }
+                           : (DyaAccum) { .i = INT64_MAX };
+    case DYA_MAX: return f ? (DyaAccum) { .f = -INFINITY }
+                           : (DyaAccum) { .i = INT64_MIN };
+    default: return f ? (DyaAccum) { .f = 0 } : (DyaAccum) { .i = 0 };
+    }
+}
+
+static inline size_t dya_group_slot(int64_t key, size_t mask)
+{
+    return dya_hash_u64((uint64_t)key, 0) & mask;
+}
+
+static size_t dya_groups_find(DyaGroups* g, int64_t key, const DyaAgg* aggs,
+    size_t n_aggs)
+{
+    size_t n_slots = dya_len(g->slots);
+    size_t mask = n_slots - 1;
+    if (n_slots) {
+        for (size_t s = dya_group_slot(key, mask);; s = (s + 1) & mask) {
+            uint32_t id = g->slots[s];
+            if (!id)
+                break;
+            if (g->keys[id - 1] == key)
+                return id - 1;
+        }
+    }
+
+    size_t id = dya_len(g->keys);
+    dya_push(g->keys, key);
+    for (size_t a = 0; a < n_aggs; a++)
+        dya_push(g->acc, dya_accum_init(aggs[a]));
+
+    // Keep the load factor at or below 1/2.
+    if ((id + 1) * 2 > n_slots) {
+        n_slots = n_slots ? n_slots * 2 : 1024;
+        mask = n_slots - 1;
+        dya_free(g->slots);
+        g->slots = dya_alloc(n_slots, sizeof *g->slots);
+        for (size_t i = 0; i <= id; i++) {
+            size_t s = dya_group_slot(g->keys[i], mask);
+            while (g->slots[s])
+                s = (s + 1) & mask;
+            g->slots[s] = (uint32_t)i + 1;
+        }
+    } else {
+        size_t s = dya_group_slot(key, mask);
+        while (g->slots[s])
+            s = (s + 1) & mask;
+        g->slots[s] = (uint32_t)id + 1;
+    }
+    return id;
+}
+
+// Looks up the groups of a batch of rows first, then runs one tight loop per
+// aggregate over the batch.
+static void dya_group_rows(const DyaGroupJob* j, DyaGroups* g, size_t begin,
+    size_t end)
+{
+    uint32_t rows[DYA_GROUP_BATCH];
+    uint32_t ids[DYA_GROUP_BATCH];
+    int64_t ivals[DYA_GROUP_BATCH];
+    double fvals[DYA_GROUP_BATCH];
+    for (size_t b = begin; b < end; b += DYA_GROUP_BATCH) {
+        size_t n = end - b < DYA_GROUP_BATCH ? end - b : DYA_GROUP_BATCH;
+        for (size_t i = 0; i < n; i++)
+            rows[i] = j->sel ? j->sel[b + i] : (uint32_t)(b + i);
+
+        dya_load_int64_t(ivals, j->key, rows, n);
+        for (size_t i = 0; i < n; i++)
+            ids[i] = (uint32_t)dya_groups_find(g, ivals[i], j->aggs, j->n_aggs);
+
+        size_t stride = j->n_aggs;
+        for (size_t a = 0; a < j->n_aggs; a++) {
+            DyaAgg agg = j->aggs[a];
+            DyaAccum* acc = g->acc + a;
+            if (agg.op == DYA_COUNT) {
+                for (size_t i = 0; i < n; i++)
+                    acc[ids[i] * stride].i++;
+                continue;
+            }
+            if (agg.col->type == DYA_F64) {
+                dya_load_double(fvals, agg.col, rows, n);
+                for (size_t i = 0; i < n; i++) {
+                    double* x = &acc[ids[i] * stride].f;
+                    switch (agg.op) {
+                    case DYA_SUM: *x += fvals[i]; break;
+                    case DYA_MIN: *x = fvals[i] < *x ? fvals[i] : *x; break;
+                    case DYA_MAX: *x = fvals[i] > *x ? fvals[i] : *x; break;
+                    default: break;
+                    }
+                }
+            } else {
+                dya_load_int64_t(ivals, agg.col, rows, n);
+                for (size_t i = 0; i < n; i++) {
+                    int64_t* x = &acc[ids[i] * stride].i;
+                    switch (agg.op) {
+                    case DYA_SUM: *x += ivals[i]; break;
+                    case DYA_MIN: *x = ivals[i] < *x ? ivals[i] : *x; break;
+                    case DYA_MAX: *x = ivals[i] > *x ? ivals[i] : *x; break;
+                    default: break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void dya_group_task(void* job, size_t i)
+{
+    DyaGroupJob* j = job;
+    for (size_t m; (m = atomic_fetch_add(&j->next, 1)) < j->n_morsels;)
+        dya_group_rows(j, &j->groups[i], m * DYA_MORSEL_ROWS,
+            dya_morsel_end(m, j->n));
+}
+
+static void dya_groups_free(DyaGroups* g)
+{
+    dya_free(g->keys);
+    dya_free(g->slots);
+    dya_free(g->acc);
+}
+
+static DyaTable dya_groups_to_table(DyaGroups* g, const DyaAgg* aggs,
+    size_t n_aggs)
+{
+    DyaTable t = { 0 };
+    size_t n = dya_len(g->keys);
+    int64_t* keys = 0;
+    dya_append(keys, dya_size(g->keys), g->keys);
+    dya_table_add_column(&t, "key", DYA_I64, keys);
+    for (size_t a = 0; a < n_aggs; a++) {
+        int f = aggs[a].op != DYA_COUNT && aggs[a].col->type == DYA_F64;
+        // Both union members are 8 bytes, so the column is just a copy.
+        DyaAccum* col = 0;
+        dya_set_len(col, n);
+        for (size_t i = 0; i < n; i++)
+            col[i] = g->acc[i * n_aggs + a];
+        dya_table_add_column(&t, aggs[a].name, f ? DYA_F64 : DYA_I64, col);
+    }
+    return t;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "dya_parallel.h"
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * A small columnar query engine over dyarray columns.
+ *
+ * A `DyaTable` owns a list of typed columns, each a plain dyarray of the same
+ * length. Queries are built from:
+ *
+ *   Selection vectors: `uint32_t` dyarrays of row numbers, in row order.
+ *                      NULL means "all rows"; filters always return a
+ *                      non-NULL selection, even when nothing matched.
+ *   Filters:           dya_filter(sel, column, predicate) keeps the rows of
+ *                      `sel` that satisfy the predicate. Predicates are
+ *                      comparisons against a constant, ranges and set
+ *                      membership, evaluated with branch-free loops.
+ *   Group-by:          dya_group_by() hashes an integer key column and computes
+ *                      COUNT, SUM, MIN and MAX per group into a new table.
+ *
+ * The `_parallel` versions split the rows into morsels of DYA_MORSEL_ROWS
+ * that `n_tasks` workers claim one at a time through `pfor` (see
+ * dya_parallel.h). Parallel filters return the same selection as serial ones.
+ *
+ * At most UINT32_MAX rows are supported.
+ *
+ * Usage example:
+    DyaTable t = { 0 };
+    dya_table_add_column(&t, "region", DYA_I32, regions);
+    dya_table_add_column(&t, "price", DYA_F64, prices);
+
+    // SELECT region, COUNT(*), SUM(price) WHERE price BETWEEN 10 AND 20
+    const DyaColumn* price = dya_table_column(&t, "price");
+    uint32_t* sel = 0;
+    dya_filter(sel, price, dya_between(dya_f64(10), dya_f64(20)));
+    DyaAgg aggs[] = { { DYA_COUNT, 0, "n" }, { DYA_SUM, price, "total" } };
+    const DyaColumn* region = dya_table_column(&t, "region");
+    DyaTable result = dya_group_by(region, sel, aggs, 2);
+
+    dya_free(sel);
+    dya_table_free(&result);
+    dya_table_free(&t);
+ */
+
+// Rows per unit of parallel work.
+#ifndef DYA_MORSEL_ROWS
+#define DYA_MORSEL_ROWS ((size_t)1 << 16)
+#endif
+
+// X(enum, C type, type it is compared and aggregated as)
+#define DYA_COLUMN_TYPES(X)                                                    \
+    X(DYA_I32, int32_t, int64_t)                                               \
+    X(DYA_I64, int64_t, int64_t)                                               \
+    X(DYA_U16, uint16_t, int64_t)                                              \
+    X(DYA_U32, uint32_t, int64_t)                                              \
+    X(DYA_F64, double, double)
+
+#define DYA_COLUMN_ENUM(e, T, W) e,
+typedef enum { DYA_COLUMN_TYPES(DYA_COLUMN_ENUM) } DyaType;
+#undef DYA_COLUMN_ENUM
+
+typedef struct {
+    const char* name;
+    DyaType type;
+    void* data; // dyarray of `type`
+} DyaColumn;
+
+typedef struct {
+    DyaColumn* columns; // dyarray
+    size_t rows;
+} DyaTable;
+
+// A constant compared against a column. Integer columns read `.i`, floating
+// point columns read `.f`.
+typedef struct {
+    int64_t i;
+    double f;
+} DyaValue;
+
+typedef enum {
+    DYA_EQ,
+    DYA_NE,
+    DYA_LT,
+    DYA_LE,
+    DYA_GT,
+    DYA_GE,
+    DYA_BETWEEN, // a <= x && x <= b
+    DYA_IN, // x is one of `set`
+} DyaPredOp;
+
+typedef struct {
+    DyaPredOp op;
+    DyaValue a, b;
+    const DyaValue* set; // dyarray, for DYA_IN
+} DyaPred;
+
+typedef enum { DYA_COUNT, DYA_SUM, DYA_MIN, DYA_MAX } DyaAggOp;
+
+// `col` is ignored for DYA_COUNT. Results over integer columns are DYA_I64,
+// over floating point columns DYA_F64.
+typedef struct {
+    DyaAggOp op;
+    const DyaColumn* col;
+    const char* name;
+} DyaAgg;
+
+#define dya_i64(v) ((DyaValue) { .i = (v), .f = (double)(v) })
+#define dya_f64(v) ((DyaValue) { .i = (int64_t)(v), .f = (v) })
+#define dya_cmp(op, v) ((DyaPred) { op, v, { 0 }, 0 })
+#define dya_between(lo, hi) ((DyaPred) { DYA_BETWEEN, lo, hi, 0 })
+#define dya_in(set) ((DyaPred) { DYA_IN, { 0 }, { 0 }, set })
+
+// Takes ownership of `data`, which must have as many rows as the table.
+void dya_table_add_column(DyaTable* t, const char* name, DyaType type,
+    void* data);
+// Returns NULL if there is no such column.
+DyaColumn* dya_table_column(const DyaTable* t, const char* name);
+// Frees every column and zeroes `t`.
+void dya_table_free(DyaTable* t);
+
+uint32_t* dya_filter(uint32_t* sel, const DyaColumn* col, DyaPred pred);
+uint32_t* dya_filter_parallel(uint32_t* sel, const DyaColumn* col,
+    DyaPred pred, size_t n_tasks, DyaParallelFor* pfor);
+
+// `key` must be an integer column. The result has a DYA_I64 column named
+// "key" followed by one column per aggregate. dya_group_by() lists groups in
+// order of first occurrence, the parallel version in no particular order.
+DyaTable dya_group_by(const DyaColumn* key, const uint32_t* sel,
+    const DyaAgg* aggs, size_t n_aggs);
+DyaTable dya_group_by_parallel(const DyaColumn* key, const uint32_t* sel,
+    const DyaAgg* aggs, size_t n_aggs, size_t n_tasks, DyaParallelFor* pfor);
+
+#define dya_filter(sel, col, pred) (sel = (dya_filter)(sel, col, pred))
+#define dya_filter_parallel(sel, col, pred, n_tasks, pfor)                     \
+    (sel = (dya_filter_parallel)(sel, col, pred, n_tasks, pfor))
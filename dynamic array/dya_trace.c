@@ -0,0 +1,300 @@
+#pragma once
+#if defined(__STRICT_ANSI__) && !defined(_GNU_SOURCE)                          \
+    && !defined(_POSIX_C_SOURCE)
+#error "dya_trace.c needs _GNU_SOURCE under -std=c11, see dya_trace.h"
+#endif
+#include "dya_trace.h"
+#include "dya_hash.h"
+#include <pthread.h>
+#include <stdlib.h> // malloc, realloc, free, qsort
+#include <string.h> // memcpy
+#include <time.h> // clock_gettime
+
+typedef struct {
+    DyaTraceEvent* events; // malloc'd, DYA_TRACE_RING_EVENTS of them
+    uint64_t head; // events ever recorded, written by the owning thread only
+    uint64_t tail; // events flushed or dropped
+    uint32_t thread;
+} DyaTraceRing;
+
+// Keeps the trace from tracing its own dyarrays.
+static _Thread_local int dya_trace_busy;
+static _Thread_local DyaTraceRing* dya_trace_ring;
+// Every ring ever registered, so that events of finished threads are kept.
+static DyaTraceRing** dya_trace_rings;
+static size_t dya_trace_lost;
+static pthread_mutex_t dya_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static DyaTraceRing* dya_trace_ring_init(void);
+static uint64_t dya_trace_now_ns(void);
+static int dya_trace_cmp(const void* a, const void* b);
+static void dya_trace_link(DyaTraceEvent* events);
+static void* dya_trace_resize(const DyaTracePolicy* policy, void* ptr,
+    size_t cap, DyaTraceReplay* stats);
+static void dya_trace_release(const DyaTracePolicy* policy, void* ptr,
+    DyaTraceReplay* stats);
+
+void dya_trace_event(uintptr_t old_arr, uintptr_t new_arr, size_t size,
+    size_t needed, size_t old_cap, size_t new_cap)
+{
+    if (!old_arr && !new_arr)
+        return;
+    if (dya_trace_busy)
+        return;
+    DyaTraceRing* ring = dya_trace_ring;
+    if (!ring)
+        ring = dya_trace_ring_init();
+    uint64_t head = ring->head;
+    ring->events[head & (DYA_TRACE_RING_EVENTS - 1)] = (DyaTraceEvent) {
+        .time_ns = dya_trace_now_ns(),
+        .old_arr = old_arr,
+        .new_arr = new_arr,
+        .size = size,
+        .needed = needed,
+        .old_cap = old_cap,
+        .new_cap = new_cap,
+        .thread = ring->thread,
+    };
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+char*(dya_trace_flush)(char* bytes)
+{
+    dya_trace_busy++;
+    pthread_mutex_lock(&dya_trace_lock);
+    for (size_t r = 0; r < dya_len(dya_trace_rings); r++) {
+        DyaTraceRing* ring = dya_trace_rings[r];
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t from = ring->tail;
+        if (head - from > DYA_TRACE_RING_EVENTS)
+            from = head - DYA_TRACE_RING_EVENTS;
+        size_t start = dya_size(bytes);
+        for (uint64_t i = from; i < head; i++) {
+            dya_append(bytes, sizeof(DyaTraceEvent),
+                &ring->events[i & (DYA_TRACE_RING_EVENTS - 1)]);
+        }
+        // The owner may have wrapped around onto events while we copied
+        // them. Those are dropped, like the ones overwritten before.
+        uint64_t now = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t kept = from;
+        if (now - kept > DYA_TRACE_RING_EVENTS)
+            kept = now - DYA_TRACE_RING_EVENTS;
+        if (kept > head)
+            kept = head;
+        if (kept > from) {
+            size_t skip = (size_t)(kept - from) * sizeof(DyaTraceEvent);
+            memmove(bytes + start, bytes + start + skip,
+                dya_size(bytes) - start - skip);
+            dya_add_size(bytes, -(ptrdiff_t)skip);
+        }
+        dya_trace_lost += (size_t)(kept - ring->tail);
+        ring->tail = head;
+    }
+    pthread_mutex_unlock(&dya_trace_lock);
+    dya_trace_busy--;
+    return bytes;
+}
+
+size_t dya_trace_dropped(void)
+{
+    pthread_mutex_lock(&dya_trace_lock);
+    size_t lost = dya_trace_lost;
+    pthread_mutex_unlock(&dya_trace_lock);
+    return lost;
+}
+
+DyaTraceEvent*(dya_trace_load)(DyaTraceEvent* events, const void* bytes,
+    size_t size)
+{
+    assert(size % sizeof *events == 0 && "Not a whole number of events!");
+    dya_set_size(events, 0);
+    dya_append(events, size, bytes);
+    // Events of one thread are already in order, which the sort keeps by
+    // comparing their positions last.
+    for (size_t i = 0; i < dya_len(events); i++)
+        events[i].array = (uint32_t)i;
+    qsort(events, dya_len(events), sizeof *events, dya_trace_cmp);
+    dya_trace_link(events);
+    return events;
+}
+
+DyaTraceReplay dya_trace_replay(const DyaTraceEvent* events,
+    const DyaTracePolicy* policy)
+{
+    DyaTraceReplay stats = { 0 };
+    uint32_t n_arrays = 0;
+    dya_foreach(const DyaTraceEvent, e, events)
+    {
+        if (e->array >= n_arrays)
+            n_arrays = e->array + 1;
+    }
+    // Per array: its buffer and capacity under `policy`.
+    void** ptrs = dya_alloc(n_arrays, sizeof *ptrs);
+    size_t* caps = dya_alloc(n_arrays, sizeof *caps);
+    size_t live = 0;
+    dya_foreach(const DyaTraceEvent, e, events)
+    {
+        uint32_t a = e->array;
+        size_t cap = caps[a];
+        if (!cap && e->new_cap)
+            stats.arrays++;
+        if (!e->new_cap) {
+            dya_trace_release(policy, ptrs[a], &stats);
+            live -= cap;
+            ptrs[a] = 0;
+            caps[a] = 0;
+            continue;
+        }
+        if (!policy->growth) {
+            // The traced capacities. Copies are what the trace copied.
+            ptrs[a] = dya_trace_resize(policy, ptrs[a], e->new_cap, &stats);
+            stats.copied_bytes += e->size;
+            live += e->new_cap - cap;
+            caps[a] = e->new_cap;
+        } else {
+            // The rows pushed since the last event found the array full
+            // whenever they passed its capacity.
+            while (cap && cap < e->size) {
+                size_t next = policy->growth(cap);
+                next = next > cap ? next : cap + 1;
+                ptrs[a] = dya_trace_resize(policy, ptrs[a], next, &stats);
+                stats.copied_bytes += cap;
+                live += next - cap;
+                cap = next;
+            }
+            if (e->needed > cap) {
+                size_t next = policy->growth(cap);
+                next = next > e->needed ? next : e->needed;
+                ptrs[a] = dya_trace_resize(policy, ptrs[a], next, &stats);
+                stats.copied_bytes += e->size;
+                live += next - cap;
+                cap = next;
+            }
+            caps[a] = cap;
+        }
+        if (live > stats.peak_bytes)
+            stats.peak_bytes = live;
+    }
+    // Arrays still alive at the end of the trace.
+    for (uint32_t a = 0; a < n_arrays; a++)
+        (policy->free ? policy->free : free)(ptrs[a]);
+    dya_free(ptrs);
+    dya_free(caps);
+    return stats;
+}
+
+// ========= PRIVATE FUNCTIONS =========
+
+static DyaTraceRing* dya_trace_ring_init(void)
+{
+    dya_trace_busy++;
+    DyaTraceRing* ring = malloc(sizeof *ring);
+    DyaTraceEvent* events = malloc(DYA_TRACE_RING_EVENTS * sizeof *events);
+    assert(ring && events && "Out of memory!");
+    *ring = (DyaTraceRing) { .events = events };
+    pthread_mutex_lock(&dya_trace_lock);
+    ring->thread = (uint32_t)dya_len(dya_trace_rings);
+    dya_push(dya_trace_rings, ring);
+    pthread_mutex_unlock(&dya_trace_lock);
+    dya_trace_ring = ring;
+    dya_trace_busy--;
+    return ring;
+}
+
+static uint64_t dya_trace_now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+// By time, then thread, then position in the trace.
+static int dya_trace_cmp(const void* a, const void* b)
+{
+    const DyaTraceEvent* x = a;
+    const DyaTraceEvent* y = b;
+    if (x->time_ns != y->time_ns)
+        return x->time_ns < y->time_ns ? -1 : 1;
+    if (x->thread != y->thread)
+        return x->thread < y->thread ? -1 : 1;
+    return (x->array > y->array) - (x->array < y->array);
+}
+
+// Gives every event the id of its array, following each data pointer from
+// event to event in an open addressing table of the live ones.
+static void dya_trace_link(DyaTraceEvent* events)
+{
+    typedef struct {
+        uint64_t arr; // 0 for an empty slot, 1 for a deleted one
+        uint32_t id;
+    } Slot;
+    size_t mask = 63;
+    size_t used = 0;
+    Slot* slots = dya_alloc(mask + 1, sizeof *slots);
+    uint32_t next_id = 0;
+    dya_foreach(DyaTraceEvent, e, events)
+    {
+        // Find the old pointer, or give the array a new id.
+        uint32_t id = next_id;
+        size_t i = dya_hash_u64(e->old_arr, 0) & mask;
+        for (; e->old_arr && slots[i].arr; i = (i + 1) & mask) {
+            if (slots[i].arr == e->old_arr) {
+                id = slots[i].id;
+                slots[i].arr = 1;
+                break;
+            }
+        }
+        if (id == next_id)
+            next_id++;
+        e->array = id;
+        if (!e->new_arr)
+            continue;
+        if (++used * 2 > mask + 1) {
+            // Rehash the live slots into a table twice their number.
+            size_t live = 0;
+            dya_foreach(Slot, s, slots) live += s->arr > 1;
+            size_t new_mask = 63;
+            while ((live + 1) * 4 > new_mask + 1)
+                new_mask = new_mask * 2 + 1;
+            Slot* old = slots;
+            slots = dya_alloc(new_mask + 1, sizeof *slots);
+            dya_foreach(Slot, s, old)
+            {
+                if (s->arr <= 1)
+                    continue;
+                size_t j = dya_hash_u64(s->arr, 0) & new_mask;
+                while (slots[j].arr)
+                    j = (j + 1) & new_mask;
+                slots[j] = *s;
+            }
+            dya_free(old);
+            mask = new_mask;
+            used = live + 1;
+        }
+        i = dya_hash_u64(e->new_arr, 0) & mask;
+        while (slots[i].arr > 1)
+            i = (i + 1) & mask;
+        slots[i] = (Slot) { e->new_arr, id };
+    }
+    dya_free(slots);
+}
+
+// Reallocates `ptr` to `cap` bytes through `policy`, counting the time.
+static void* dya_trace_resize(const DyaTracePolicy* policy, void* ptr,
+    size_t cap, DyaTraceReplay* stats)
+{
+    uint64_t start = dya_trace_now_ns();
+    void* grown = (policy->realloc ? policy->realloc : realloc)(ptr, cap);
+    stats->seconds += (double)(dya_trace_now_ns() - start) * 1e-9;
+    assert(grown && "Out of memory!");
+    stats->reallocs++;
+    return grown;
+}
+
+static void dya_trace_release(const DyaTracePolicy* policy, void* ptr,
+    DyaTraceReplay* stats)
+{
+    uint64_t start = dya_trace_now_ns();
+    (policy->free ? policy->free : free)(ptr);
+    stats->seconds += (double)(dya_trace_now_ns() - start) * 1e-9;
+}
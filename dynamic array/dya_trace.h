@@ -0,0 +1,90 @@
+#pragma once
+#include "dyarray.h"
+#include <stdint.h>
+/*
+ * Allocation tracing of dyarrays, and offline replay of the traces against
+ * other growth policies and allocators.
+ *
+ * When dyarray.c is compiled with DYA_TRACE defined, every growth, dya_free
+ * and dya_to_pointer stores a DyaTraceEvent in a ring of the calling thread.
+ * The ring holds the last `DYA_TRACE_RING_EVENTS` events, so flush it more
+ * often than that; older events are overwritten and counted in
+ * dya_trace_dropped. dya_trace_flush moves every thread's events to a byte
+ * dyarray, to be written to a file as is. The trace's own dyarrays are not
+ * traced.
+ *
+ * dya_trace_load reads such bytes back in time order and links each chain of
+ * reallocations into one array id. dya_trace_replay then re-runs the trace
+ * with `policy`: each array grows when the size asked for passes its
+ * capacity, to what `policy->growth` returns, through `policy->realloc` and
+ * `policy->free`. Between two traced events an array is assumed to have
+ * grown one row at a time, which is exact for dya_push loops, so a policy
+ * that grows more slowly pays for the reallocations the traced one skipped.
+ * NULL members replay the traced capacities and libc's allocator.
+ *
+ * dya_trace.c calls clock_gettime, which strict ISO modes hide: build it
+ * with -std=gnu11, or `#define _GNU_SOURCE` (or _POSIX_C_SOURCE 199309L)
+ * before any #include.
+ *
+ * Usage example:
+    // In the service, built with -DDYA_TRACE:
+    char* bytes = 0;
+    dya_trace_flush(bytes);
+    fwrite(bytes, 1, dya_size(bytes), trace_file);
+
+    // In the replay tool:
+    DyaTraceEvent* events = 0;
+    dya_trace_load(events, file_bytes, file_size);
+    DyaTraceReplay doubling = dya_trace_replay(events,
+        &(DyaTracePolicy) { .growth = grow_2x, .realloc = je_realloc,
+            .free = je_free });
+    printf("%.3fs peak %zu copied %zu\n", doubling.seconds,
+        doubling.peak_bytes, doubling.copied_bytes);
+ */
+
+// Events kept per thread between flushes. Must be a power of two.
+#ifndef DYA_TRACE_RING_EVENTS
+#define DYA_TRACE_RING_EVENTS ((size_t)1 << 16)
+#endif
+
+typedef struct {
+    uint64_t time_ns; // CLOCK_MONOTONIC
+    uint64_t old_arr; // data pointer before, 0 for a new array
+    uint64_t new_arr; // data pointer after, 0 for a free
+    uint64_t size; // bytes in use
+    uint64_t needed; // capacity asked for, 0 for a free
+    uint64_t old_cap;
+    uint64_t new_cap; // 0 for a free
+    uint32_t thread; // registration order, from 0
+    uint32_t array; // set by dya_trace_load, the same along a chain
+} DyaTraceEvent;
+
+typedef struct {
+    // Returns the capacity to grow to from `cap`. Results below the size
+    // asked for are raised to it.
+    size_t (*growth)(size_t cap);
+    void* (*realloc)(void* ptr, size_t size);
+    void (*free)(void* ptr);
+} DyaTracePolicy;
+
+typedef struct {
+    double seconds; // spent in realloc and free
+    size_t arrays;
+    size_t reallocs; // including the first allocation of an array
+    size_t copied_bytes; // bytes in use at every reallocation
+    size_t peak_bytes; // most capacity alive at once
+} DyaTraceReplay;
+
+// Appends the events of every thread since the last flush.
+char* dya_trace_flush(char* bytes);
+// Events lost to full rings so far.
+size_t dya_trace_dropped(void);
+// Resizes `events` to the events in `bytes`, sorted by time.
+DyaTraceEvent* dya_trace_load(DyaTraceEvent* events, const void* bytes,
+    size_t size);
+DyaTraceReplay dya_trace_replay(const DyaTraceEvent* events,
+    const DyaTracePolicy* policy);
+
+#define dya_trace_flush(bytes) (bytes = (dya_trace_flush)(bytes))
+#define dya_trace_load(events, bytes, size)                                    \
+    (events = (dya_trace_load)(events, bytes, size))
@@ -1,13 +1,36 @@
 #pragma once
 #include "dyarray.h"
+#include <stdint.h> // SIZE_MAX, uintptr_t
 #include <stdlib.h> // realloc, free
-#include <string.h> // memset, memmove
+#include <string.h> // memset, memmove, memcpy
 
 // 1.5 growth factor, starting at 64 bytes.
 #define DYA_GROWTH(cap) dya_growth(cap)
 #define DYA_REALLOC(ptr, size) realloc(ptr, size)
 #define DYA_FREE(ptr) free(ptr)
 
+// With DYA_TRACE, every growth and free is logged by dya_trace.c.
+// Otherwise the arguments are only type-checked.
+void dya_trace_event(uintptr_t old_arr, uintptr_t new_arr, size_t size,
+    size_t needed, size_t old_cap, size_t new_cap);
+#ifdef DYA_TRACE
+#define DYA_TRACE_EVENT(...) dya_trace_event(__VA_ARGS__)
+#else
+#define DYA_TRACE_EVENT(...) ((void)sizeof(dya_trace_event(__VA_ARGS__), 0))
+#endif
+
+// With DYA_USDT, USDT probes for bpftrace and perf under the `dyarray`
+// provider. Each one is a single NOP until a tracer attaches to it.
+#ifdef DYA_USDT
+#include <sys/sdt.h>
+#define DYA_PROBE3(name, a, b, c) DTRACE_PROBE3(dyarray, name, a, b, c)
+#define DYA_PROBE5(name, a, b, c, d, e)                                        \
+    DTRACE_PROBE5(dyarray, name, a, b, c, d, e)
+#else
+#define DYA_PROBE3(...) ((void)0)
+#define DYA_PROBE5(...) ((void)0)
+#endif
+
 // TODO: Currently should work with any vanilla C type/struct unless user
 // manually specified a stricter alignment for their type.
 #define DYA_OFFSET sizeof(DyaHeader)
@@ -15,6 +38,9 @@ typedef struct {
     size_t cap; // Invariant: cap <= SIZE_MAX / 2 (catches unsigned underflow)
     size_t size; // Invariant: size <= cap
 } DyaHeader;
+// Set in the stored `cap` of arrays built by dya_place, whose memory belongs
+// to someone else. dya_header masks it out.
+#define DYA_BORROWED (SIZE_MAX / 2 + 1)
 
 #define dya_check_cap(cap) dya_check_size_and_cap(0, cap);
 #define dya_check_size_and_cap(size, cap)                                      \
@@ -24,7 +50,7 @@ static inline size_t dya_zmax(size_t a, size_t b);
 static inline size_t dya_zmin(size_t a, size_t b);
 // Returns NULL on NULL.
 static inline DyaHeader* dya_base_ptr(void* arr);
-// Returns a zero-initialized header on NULL.
+// Returns a zero-initialized header on NULL. Never has DYA_BORROWED set.
 static inline DyaHeader dya_header(const void* arr);
 // Does nothing on NULL.
 static inline void dya_set_header(void* arr, DyaHeader new_header);
@@ -36,38 +62,49 @@ static inline size_t dya_growth(size_t cap);
 // Some of these functions have parentheses around their names to prevent macro
 // expansion.
 
-size_t dya_size(const void* arr) { return dya_header(arr).size; }
+DYA_API size_t dya_size(const void* arr) { return dya_header(arr).size; }
 
-void*(dya_set_size)(void* arr, size_t new_size)
+DYA_API void*(dya_set_size)(void* arr, size_t new_size)
 {
-    size_t cap = dya_header(arr).cap;
-    if (new_size > cap)
-        dya_reserve(arr, new_size - cap);
+    DyaHeader header = dya_header(arr);
+    if (new_size > header.cap)
+        dya_reserve(arr, new_size - header.size);
 
     dya_set_size_without_growing(arr, new_size);
     return arr;
 }
 
-void*(dya_add_size)(void* arr, ptrdiff_t add_size)
+DYA_API void*(dya_add_size)(void* arr, ptrdiff_t add_size)
 {
     return dya_set_size(arr, dya_size(arr) + (size_t)add_size);
 }
 
-void*(dya_reserve)(void* arr, size_t add_capacity)
+DYA_API void*(dya_reserve)(void* arr, size_t add_capacity)
 {
     DyaHeader header = dya_header(arr);
     if (header.size + add_capacity <= header.cap)
         return arr;
 
+    size_t old_cap = header.cap;
     header.cap = dya_zmax(header.size + add_capacity, DYA_GROWTH(header.cap));
 
-    arr = dya_realloc(arr, header.cap);
+    uintptr_t old_arr = (uintptr_t)arr;
+    int borrowed = dya_is_borrowed(arr);
+    DYA_PROBE5(grow, arr, header.size, header.size + add_capacity, old_cap,
+        header.cap);
+    // A borrowed array moves to the heap and leaves its slot behind.
+    arr = dya_realloc(borrowed ? 0 : arr, header.cap);
+    if (borrowed && header.size)
+        memcpy(arr, (void*)old_arr, header.size);
+    DYA_PROBE5(realloc, old_arr, arr, header.size, old_cap, header.cap);
+    DYA_TRACE_EVENT(old_arr, (uintptr_t)arr, header.size,
+        header.size + add_capacity, old_cap, header.cap);
 
     dya_set_header(arr, header);
     return arr;
 }
 
-void*(dya_append)(void* arr, size_t size, const char other[size])
+DYA_API void*(dya_append)(void* arr, size_t size, const char other[size])
 {
     if (!other || !size)
         return arr;
@@ -77,7 +114,7 @@ void*(dya_append)(void* arr, size_t size, const char other[size])
     return arr;
 }
 
-void* dya_alloc(size_t n, size_t row_size)
+DYA_API void* dya_alloc(size_t n, size_t row_size)
 {
     if (!n || !row_size)
         return 0;
@@ -86,14 +123,51 @@ void* dya_alloc(size_t n, size_t row_size)
     return memset(arr, 0, dya_size(arr));
 }
 
-void*(dya_to_pointer)(void* arr)
+DYA_API void*(dya_to_pointer)(void* arr)
 {
     if (!arr)
         return 0;
-    return memmove(dya_base_ptr(arr), arr, dya_size(arr));
+    DyaHeader header = dya_header(arr);
+    DYA_TRACE_EVENT((uintptr_t)arr, 0, header.size, 0, header.cap, 0);
+    DYA_PROBE3(to_pointer, arr, header.size, header.cap);
+    if (dya_is_borrowed(arr))
+        return memcpy(DYA_REALLOC(0, header.size ? header.size : 1), arr,
+            header.size);
+    return memmove(dya_base_ptr(arr), arr, header.size);
+}
+
+DYA_API void(dya_free)(void* arr)
+{
+    DYA_TRACE_EVENT((uintptr_t)arr, 0, dya_size(arr), 0, dya_header(arr).cap,
+        0);
+    DYA_PROBE3(free, arr, dya_size(arr), dya_header(arr).cap);
+    if (!dya_is_borrowed(arr))
+        DYA_FREE(dya_base_ptr(arr));
+}
+
+DYA_API size_t dya_place_size(size_t cap)
+{
+    assert(cap <= SIZE_MAX / 2 && "Capacity overflow!");
+    return DYA_OFFSET + (cap + DYA_OFFSET - 1) / DYA_OFFSET * DYA_OFFSET;
+}
+
+DYA_API void* dya_place(void* mem, size_t cap, const void* arr)
+{
+    DyaHeader header = dya_header(arr);
+    assert(header.size <= cap && "Slot smaller than the array!");
+    assert(cap <= SIZE_MAX / 2 && "Capacity overflow!");
+    assert((uintptr_t)mem % DYA_OFFSET == 0 && "Misaligned slot!");
+    *(DyaHeader*)mem = (DyaHeader) { cap | DYA_BORROWED, header.size };
+    void* placed = (char*)mem + DYA_OFFSET;
+    if (header.size)
+        memcpy(placed, arr, header.size);
+    return placed;
 }
 
-void(dya_free)(void* arr) { DYA_FREE(dya_base_ptr(arr)); }
+DYA_API int dya_is_borrowed(const void* arr)
+{
+    return arr && dya_base_ptr((void*)arr)->cap & DYA_BORROWED;
+}
 
 // ========= PRIVATE FUNCTIONS =========
 
@@ -109,7 +183,11 @@ static inline DyaHeader* dya_base_ptr(void* arr)
 
 static inline DyaHeader dya_header(const void* arr)
 {
-    return arr ? (DyaHeader) { 0 } : *dya_base_ptr((void*)arr);
+    if (!arr)
+        return (DyaHeader) { 0 };
+    DyaHeader header = *dya_base_ptr((void*)arr);
+    header.cap &= ~DYA_BORROWED;
+    return header;
 }
 
 static inline void dya_set_header(void* arr, DyaHeader new_header)
@@ -139,5 +217,5 @@ static inline void* dya_realloc(void* ptr, size_t cap)
 
 static inline size_t dya_growth(size_t cap)
 {
-    return (cap ? dya_zmin(64, (cap * 3 + 1) / 2) : 0);
+    return (cap ? dya_zmax(64, (cap * 3 + 1) / 2) : 0);
 }
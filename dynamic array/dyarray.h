@@ -26,6 +26,27 @@
  *
  * The notion of "rows" used in some macros refers to the data type of array[0].
  *
+ * Build modes:
+ * Include "dyarray.c" in exactly one translation unit, or equivalently
+ * `#define DYA_IMPLEMENTATION` before including this header there.
+ * Other translation units only include the header and call the functions
+ * out of line. With `#define DYA_STATIC_INLINE` (in every translation unit,
+ * usually from the build flags) the header carries the definitions itself
+ * as static inline functions, so that the compiler can inline the capacity
+ * check of dya_push and friends into the caller without LTO.
+ *
+ * Tracing:
+ * `#define DYA_USDT` when compiling dyarray.c adds USDT probes (needs
+ * <sys/sdt.h> from systemtap-sdt-dev) that cost one NOP each until a tracer
+ * attaches:
+ *   dyarray:grow        arr, size, needed capacity, old cap, new cap
+ *   dyarray:realloc     old arr, new arr, size, old cap, new cap
+ *   dyarray:free        arr, size, cap
+ *   dyarray:to_pointer  arr, size, cap
+ * e.g. `bpftrace -e 'usdt:./app:dyarray:realloc { @[ustack] = count(); }'`.
+ * `#define DYA_TRACE` logs the same events for offline replay, see
+ * dya_trace.h.
+ *
  * Usage example:
     // Create a 40-wide array of struct tm
 
@@ -57,37 +78,57 @@
     dya_free(arr);
  */
 
-size_t dya_size(const void* arr);
+#ifdef DYA_STATIC_INLINE
+#define DYA_API static inline
+#ifndef DYA_IMPLEMENTATION
+#define DYA_IMPLEMENTATION
+#endif
+#else
+#define DYA_API
+#endif
+
+DYA_API size_t dya_size(const void* arr);
 #define dya_len(arr) (dya_size(arr) / sizeof *arr)
 
 // Allocate a new array with `n` rows filled with 0.
 #define dya_init(n, row_size) dya_alloc(n, row_size)
 // Allocate a new array with `n` rows filled with 0.
-void* dya_alloc(size_t n, size_t row_size);
+DYA_API void* dya_alloc(size_t n, size_t row_size);
 
 /* ========= THESE FUNCTIONS ARE ACTUALLY MACROS ========= */
 // These macros reassign `arr` to the return value of the function.
 
-void* dya_set_size(void* arr, size_t new_size);
-#define dya_set_len(arr, new_len) dya_set_size(arr, new_len * sizeof *arr)
+DYA_API void* dya_set_size(void* arr, size_t new_size);
+#define dya_set_len(arr, new_len) dya_set_size(arr, (new_len) * sizeof *arr)
 // `add_size` may be negative.
-void* dya_add_size(void* arr, ptrdiff_t add_size);
-#define dya_add_len(arr, add_len) dya_add_size(arr, add_len * sizeof *arr)
+DYA_API void* dya_add_size(void* arr, ptrdiff_t add_size);
+#define dya_add_len(arr, add_len) dya_add_size(arr, (add_len) * sizeof *arr)
 
 // Reserve capacity for at least `add_capacity` additional bytes.
-void* dya_reserve(void* arr, size_t add_capacity);
+DYA_API void* dya_reserve(void* arr, size_t add_capacity);
 
 // Copies `size` bytes from `other` into `arr`.
 // `other` can be a regular pointer of any type.
-void* dya_append(void* arr, size_t size, const char other[size]);
+DYA_API void* dya_append(void* arr, size_t size, const char other[size]);
 
 // deallocates and sets `arr` to NULL.
-void dya_free(void* arr);
+DYA_API void dya_free(void* arr);
 
 // Removes the size and capacity info and turns the array into a vanilla pointer
 // that must be freed normally.
 // Useful when passing to functions that will try to free() the array.
-void* dya_to_pointer(void* arr);
+DYA_API void* dya_to_pointer(void* arr);
+
+// Bytes of memory that dya_place needs for an array of capacity `cap`,
+// a multiple of 16.
+DYA_API size_t dya_place_size(size_t cap);
+// Builds an array of capacity `cap` holding a copy of `arr` at `mem`, which
+// must be 16-byte aligned and dya_place_size(cap) bytes long. The new array
+// is borrowed: dya_free does nothing to it, and growing it or turning it into
+// a pointer copies it to the heap. Used by dya_compact.
+DYA_API void* dya_place(void* mem, size_t cap, const void* arr);
+// Whether `arr` was built by dya_place and still lives there.
+DYA_API int dya_is_borrowed(const void* arr);
 
 #define dya_set_size(arr, new_size) (arr = (dya_set_size)(arr, new_size))
 #define dya_add_size(arr, add_size) (arr = (dya_add_size)(arr, add_size))
@@ -133,3 +174,7 @@ void* dya_to_pointer(void* arr);
 #define dya_pop(arr) (dya_add_len(arr, -1), arr[dya_len(arr)])
 
 // clang-format on
+
+#ifdef DYA_IMPLEMENTATION
+#include "dyarray.c"
+#endif
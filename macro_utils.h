@@ -5,6 +5,21 @@
 // Makes a unique variable name for use in macros to prevent shadowing.
 #define M_VAR(name) CONCAT2(MACRO_VAR_##name##_, __LINE__)
 
+// Makes `fn(&var)` run when the variable declared with it leaves its scope,
+// however it leaves: `TYPE var CLEANUP(fn) = ...;`
+#define CLEANUP(fn) __attribute__((cleanup(fn)))
+
+// Times the rest of the enclosing scope as zone `name`, a string literal.
+// Unless DYA_PROFILE is defined (see dya_profile.h), it only checks `name`,
+// so code that builds without profiling also builds with it.
+#ifdef DYA_PROFILE
+#define PROFILE_ZONE(name)                                                     \
+    DyaZone M_VAR(zone) CLEANUP(dya_zone_end)                                  \
+        = dya_zone_begin(STRING_LITERAL(name))
+#else
+#define PROFILE_ZONE(name) ((void)STRING_LITERAL(name))
+#endif
+
 #define CONCAT2_(_1, _2) _1##_2
 #define CONCAT2(_1, _2) CONCAT2_(_1, _2)
 #define CONCAT3(_1, ...) CONCAT2(_1, CONCAT2(__VA_ARGS__))